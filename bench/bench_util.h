@@ -0,0 +1,62 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+// Pieces shared by the benchmarks
+#include "common.h"
+
+// The application logs to cout; results go to the real stdout
+static ostream report(cout.rdbuf());
+
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+};
+static NullBuffer nullBuffer;
+
+// Silence the application's logging once the benchmark starts measuring
+inline void silenceApplicationLog() {
+    cout.rdbuf(&nullBuffer);
+}
+
+// Temporary working directory, so files the application writes to the
+// current directory (detection results, recordings, catalogs) are removed
+struct ScratchDirectory {
+    filesystem::path startDirectory;
+    filesystem::path path;
+};
+
+inline bool enterScratchDirectory(const string& prefix, ScratchDirectory& scratch) {
+    scratch.startDirectory = filesystem::current_path();
+    string scratchTemplate = (filesystem::temp_directory_path() / (prefix + "_XXXXXX")).string();
+    if (!mkdtemp(&scratchTemplate[0])) {
+        cerr << "Failed to create a scratch directory in " << filesystem::temp_directory_path() << endl;
+        return false;
+    }
+    scratch.path = scratchTemplate;
+    filesystem::current_path(scratch.path);
+    return true;
+}
+
+inline void leaveScratchDirectory(const ScratchDirectory& scratch) {
+    error_code error;
+    filesystem::current_path(scratch.startDirectory, error);
+    filesystem::remove_all(scratch.path, error);
+}
+
+// Quoted JSON string, with the characters JSON does not allow raw escaped
+inline void writeJsonString(ostream& out, const string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (uint8_t(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(uint8_t(c)));
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,308 @@
+// Micro-benchmarks of the detection pipeline, run on synthetic drip scenes at
+// several ROI sizes and drop densities, with the application's detection code
+// and globals (area bounds at their defaults). Each stage is timed on its own, in
+// the style of Google Benchmark: iterations grow until a run lasts at least
+// --min-time, and the time and heap allocations per iteration of that run
+// are reported (allocations of OpenCV's worker threads are not counted,
+// --threads 0 runs everything on the benchmark thread). Mats come from the
+// buffer pool as in the application, --no-pool uses OpenCV's allocator.
+// Runs on the Pi and on x86, no camera needed:
+//   ./detection_bench [--min-time S] [--filter TEXT] [--threads N] [--no-pool]
+#include "common.h"
+#include "background_subtraction.h"
+#include "synthetic_source.h"
+#include "alloc_stats.h"
+#include "mat_pool.h"
+#include "bench_util.h"
+
+// Frames rendered per scene; the stages cycle over them
+static const int SCENE_FRAMES = 30;
+static const double SCENE_FPS = 30.0;
+
+// Detection state is reset after this many frames, as a detection run ends after the timeout
+static const int SESSION_FRAMES = BG_SUB_TIMEOUT_SECONDS * int(SCENE_FPS);
+
+// Upper bound on the iterations of a single run
+static const int64_t MAX_ITERATIONS = 1000000000;
+
+// ROI sizes: the 100x100 box placed by a click, up to the whole 720p frame
+static const Size ROI_SIZES[] = {Size(100, 100), Size(320, 240), Size(640, 480), Size(1280, 720)};
+
+// Drop sources in the scene
+static const int DROP_DENSITIES[] = {0, 4, 16};
+
+// One ROI size and drop density, with the output of every stage precomputed
+// so each stage can be timed on realistic input
+struct Scene {
+    Size roiSize;
+    int dropSources;
+    vector<Mat> frames;                         // ROI pixels, CV_8UC3
+    vector<Mat> masks;                          // MOG2 output of a warmed-up model
+    vector<Mat> cleanMasks;                     // after threshold, erode and dilate
+    vector<vector<vector<Point>>> contours;     // findContours of cleanMasks
+    vector<vector<DropDetection>> detections;   // contours passing the area filter
+};
+
+// Grouping of a frame's detections into drop points, as processBackgroundSubtraction does it
+static void addDetectionPoints(const vector<DropDetection>& detections) {
+    for (const DropDetection& detection : detections) {
+        addDetectionPoint(detection.box.tl());
+    }
+}
+
+// Detection state at the end of a full session over the scene
+static void runSession(const Scene& scene) {
+    resetDetectionState();
+    for (int i = 0; i < SESSION_FRAMES; i++) {
+        addDetectionPoints(scene.detections[i % SCENE_FRAMES]);
+    }
+}
+
+static Scene buildScene(Size roiSize, int dropSources) {
+    Scene scene;
+    scene.roiSize = roiSize;
+    scene.dropSources = dropSources;
+
+    // Sources in two rows across the ROI, each dropping about every 0.3 s
+    SyntheticSceneOptions options;
+    options.frameSize = roiSize;
+    options.fps = SCENE_FPS;
+    options.fallDistance = roiSize.height * 2 / 5;
+    options.dropSpeed = options.fallDistance / 0.3;
+    options.dropIntervalSeconds = dropSources > 0 ? 0.3 : 3600.0;
+    int columns = max(1, (dropSources + 1) / 2);
+    for (int i = 0; i < max(1, dropSources); i++) {
+        int column = i % columns;
+        int row = i / columns;
+        options.dropSources.push_back(Point((2 * column + 1) * roiSize.width / (2 * columns),
+                                            roiSize.height / 10 + row * roiSize.height / 2));
+    }
+
+    SyntheticDripSource source(options);
+    scene.frames.resize(SCENE_FRAMES);
+    for (Mat& frame : scene.frames) {
+        source.read(frame);
+    }
+
+    // Let the model learn the background before taking its masks
+    Ptr<BackgroundSubtractorMOG2> subtractor = createBackgroundSubtractorMOG2(300, 16, true);
+    Mat mask;
+    for (int pass = 0; pass < 3; pass++) {
+        for (const Mat& frame : scene.frames) {
+            subtractor->apply(frame, mask);
+        }
+    }
+    resetDetectionState();
+    for (const Mat& frame : scene.frames) {
+        Mat foregroundMask;
+        subtractor->apply(frame, foregroundMask);
+        scene.masks.push_back(foregroundMask.clone());
+        cleanForegroundMask(foregroundMask);
+        scene.cleanMasks.push_back(foregroundMask);
+        vector<vector<Point>> contours;
+        findContours(foregroundMask, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        scene.contours.push_back(contours);
+        vector<DropDetection> detections;
+        filterContours(contours, Point(0, 0), detections);
+        scene.detections.push_back(detections);
+    }
+    resetDetectionState();
+    return scene;
+}
+
+// A stage under test: prepare() builds its state from the scene and returns
+// the body that is timed, one call per frame (or per call for per-session work)
+struct Benchmark {
+    const char* name;
+    const char* unit;
+    function<function<void()>(const Scene&)> prepare;
+};
+
+static const Benchmark BENCHMARKS[] = {
+    {"MOG2Apply", "frame", [](const Scene& scene) -> function<void()> {
+        Ptr<BackgroundSubtractorMOG2> subtractor = createBackgroundSubtractorMOG2(300, 16, true);
+        int i = 0;
+        return [&scene, subtractor, i]() mutable {
+            Mat foregroundMask;
+            subtractor->apply(scene.frames[i++ % SCENE_FRAMES], foregroundMask);
+        };
+    }},
+    {"ThresholdErodeDilate", "frame", [](const Scene& scene) -> function<void()> {
+        Mat mask;
+        int i = 0;
+        return [&scene, mask, i]() mutable {
+            scene.masks[i++ % SCENE_FRAMES].copyTo(mask);
+            cleanForegroundMask(mask);
+        };
+    }},
+    {"FindContours", "frame", [](const Scene& scene) -> function<void()> {
+        // Storage reused between calls, as processBackgroundSubtraction does
+        vector<vector<Point>> contours;
+        int i = 0;
+        return [&scene, contours, i]() mutable {
+            findContours(scene.cleanMasks[i++ % SCENE_FRAMES], contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        };
+    }},
+    {"ContourFilter", "frame", [](const Scene& scene) -> function<void()> {
+        resetDetectionState();
+        vector<DropDetection> detections;
+        return [&scene, detections]() mutable {
+            if (frameNumber == SESSION_FRAMES) {
+                resetDetectionState();
+            }
+            filterContours(scene.contours[frameNumber % SCENE_FRAMES], Point(0, 0), detections);
+            frameNumber++;
+        };
+    }},
+    {"FindSimilarPoint", "frame", [](const Scene& scene) -> function<void()> {
+        resetDetectionState();
+        return [&scene]() {
+            if (frameNumber == SESSION_FRAMES) {
+                resetDetectionState();
+            }
+            addDetectionPoints(scene.detections[frameNumber % SCENE_FRAMES]);
+            frameNumber++;
+        };
+    }},
+    {"DrawDetectionResults", "frame", [](const Scene& scene) -> function<void()> {
+        runSession(scene);
+        Mat canvas = scene.frames[0].clone();
+        return [canvas]() mutable {
+            drawDetectionResults(canvas);
+        };
+    }},
+    {"SaveTopDetectionPoints", "call", [](const Scene& scene) -> function<void()> {
+        runSession(scene);
+        return []() {
+            saveTopDetectionPoints(10);
+        };
+    }},
+    // The whole detection stage of the main loop, for comparison with the sum of the parts
+    // (includes copying the frame, which the stage draws on)
+    {"ProcessBackgroundSubtraction", "frame", [](const Scene& scene) -> function<void()> {
+        resetDetectionState();
+        backgroundSubtractor = createBackgroundSubtractorMOG2(300, 16, true);
+        bgSubtractionRect = Rect(Point(0, 0), scene.roiSize);
+        bgSubtractionActive = true;
+        Mat frame;
+        return [&scene, frame]() mutable {
+            if (frameNumber == SESSION_FRAMES) {
+                resetDetectionState();
+            }
+            // Never reach the timeout, however slow the machine
+            bgSubStartTime = frameCaptureTime = steady_clock::now();
+            scene.frames[frameNumber % SCENE_FRAMES].copyTo(frame);
+            processBackgroundSubtraction(frame);
+        };
+    }},
+};
+
+struct BenchResult {
+    int64_t iterations;
+    double nsPerIteration;
+    double allocsPerIteration;
+    double bytesPerIteration;
+};
+
+static BenchResult runBenchmark(function<void()>& body, double minSeconds) {
+    // One cycle over the scene first, so buffers allocated once are not counted
+    for (int i = 0; i < SCENE_FRAMES; i++) {
+        body();
+    }
+
+    int64_t iterations = 1;
+    while (true) {
+        AllocCount before = threadAllocCount();
+        steady_clock::time_point start = steady_clock::now();
+        for (int64_t i = 0; i < iterations; i++) {
+            body();
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        if (seconds >= minSeconds || iterations >= MAX_ITERATIONS) {
+            AllocCount after = threadAllocCount();
+            return BenchResult{iterations, seconds * 1e9 / iterations,
+                               double(after.allocations - before.allocations) / iterations,
+                               double(after.bytes - before.bytes) / iterations};
+        }
+
+        // Aim past the target from the last run, growing at most 10x at a time
+        double multiplier = seconds > 0 ? minSeconds * 1.4 / seconds : 10.0;
+        multiplier = min(10.0, max(1.0, multiplier));
+        iterations = min(MAX_ITERATIONS, max(iterations + 1, int64_t(iterations * multiplier)));
+    }
+}
+
+static string benchmarkName(const Benchmark& benchmark, Size roiSize, int dropSources) {
+    return string(benchmark.name) + "/" + to_string(roiSize.width) + "x" +
+           to_string(roiSize.height) + "/drops:" + to_string(dropSources);
+}
+
+int main(int argc, char** argv) {
+    double minSeconds = 0.5;
+    string filter;
+    bool useMatPool = true;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--min-time" && i + 1 < argc) {
+            minSeconds = max(0.0, atof(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            setNumThreads(atoi(argv[++i]));
+        } else if (arg == "--no-pool") {
+            useMatPool = false;
+        } else {
+            cout << "Usage: " << argv[0] << " [--min-time S] [--filter TEXT] [--threads N] [--no-pool]" << endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (useMatPool) {
+        installMatPool();
+    }
+    startAllocTracking();
+
+    // saveTopDetectionPoints writes to ./drip_detect, keep that out of the current directory
+    ScratchDirectory scratch;
+    if (!enterScratchDirectory("detection_bench", scratch)) {
+        return 1;
+    }
+
+    report << "Running on " << thread::hardware_concurrency() << " CPUs, OpenCV "
+           << CV_VERSION << ", " << getNumThreads() << " threads"
+           << (useMatPool ? "" : ", no Mat pool") << endl;
+    report << left << setw(48) << "Benchmark" << right << setw(20) << "Time"
+           << setw(12) << "Iterations" << setw(14) << "Allocs/iter" << setw(14) << "Bytes/iter" << endl;
+    report << string(108, '-') << endl;
+    silenceApplicationLog();
+
+    for (Size roiSize : ROI_SIZES) {
+        for (int dropSources : DROP_DENSITIES) {
+            vector<const Benchmark*> selected;
+            for (const Benchmark& benchmark : BENCHMARKS) {
+                if (benchmarkName(benchmark, roiSize, dropSources).find(filter) != string::npos) {
+                    selected.push_back(&benchmark);
+                }
+            }
+            if (selected.empty()) {
+                continue;
+            }
+
+            Scene scene = buildScene(roiSize, dropSources);
+            for (const Benchmark* benchmark : selected) {
+                function<void()> body = benchmark->prepare(scene);
+                BenchResult result = runBenchmark(body, minSeconds);
+                ostringstream time;
+                time << fixed << setprecision(0) << result.nsPerIteration << " ns/" << benchmark->unit;
+                report << left << setw(48) << benchmarkName(*benchmark, roiSize, dropSources)
+                       << right << setw(20) << time.str() << setw(12) << result.iterations
+                       << fixed << setprecision(1) << setw(14) << result.allocsPerIteration
+                       << setprecision(0) << setw(14) << result.bytesPerIteration << endl;
+            }
+        }
+    }
+
+    leaveScratchDirectory(scratch);
+    return 0;
+}
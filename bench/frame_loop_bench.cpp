@@ -0,0 +1,308 @@
+// Runs the main loop stages (capture, detection, recording write, display
+// resize, overlays, optionally the post-processing remux) headless on a
+// synthetic scene or a video file, as fast as they go, and writes sustained
+// fps, per-stage percentiles and heap allocations, CPU use, peak RSS and
+// bytes written as JSON so releases can be compared before they go out.
+// Mats come from the buffer pool as in the application unless --no-pool:
+//   ./frame_loop_bench [--source synthetic|FILE] [--frames N] [--size WxH] [--display WxH]
+//                      [--roi N] [--no-record] [--postprocess] [--no-pool] [--out FILE]
+#include "common.h"
+#include "camera.h"
+#include "clock_service.h"
+#include "ui.h"
+#include "ui_helpers.h"
+#include "recording.h"
+#include "recordings_catalog.h"
+#include "background_subtraction.h"
+#include "digital_zoom.h"
+#include "frame_pacing.h"
+#include "frame_pipeline.h"
+#include "latency_stats.h"
+#include "mat_pool.h"
+#include "synthetic_source.h"
+#include "bench_util.h"
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// The benchmark runs on the default settings, no config file is written
+Config appConfig("./frame_loop_bench.ini", false);
+
+// Frames run before the measurement starts (model learning, first allocations)
+static const int WARMUP_FRAMES = 30;
+
+// Stages reported; imshow and waitKey need a display and are not run
+static const LatencyStage REPORTED_STAGES[] = {
+    LATENCY_CAPTURE, LATENCY_DETECTION, LATENCY_RECORDING, LATENCY_RESIZE, LATENCY_OVERLAY, LATENCY_FRAME
+};
+
+// Synthetic scene or video file, read as fast as possible
+struct ReplaySource {
+    unique_ptr<SyntheticDripSource> synthetic;
+    VideoCapture capture;
+    double fps = 30.0;
+
+    bool read(Mat& frame) {
+        return synthetic ? synthetic->read(frame) : capture.read(frame);
+    }
+};
+
+static bool parseSize(const string& text, Size& size) {
+    return sscanf(text.c_str(), "%dx%d", &size.width, &size.height) == 2 &&
+           size.width > 0 && size.height > 0;
+}
+
+static long long fileSize(const string& path) {
+    struct stat fileStat;
+    return stat(path.c_str(), &fileStat) == 0 ? fileStat.st_size : 0;
+}
+
+static double cpuSeconds(const rusage& usage) {
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static string defaultOutputPath() {
+    time_t now = time(0);
+    char buffer[80];
+    strftime(buffer, 80, "./frame_loop_%Y%m%d_%H%M%S.json", localtime(&now));
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+    string source = "synthetic";
+    int frameLimit = 900;
+    Size sceneSize(1280, 720);
+    Size displaySize(1280, 800);
+    int roiSize = 100;
+    bool record = true;
+    bool postProcess = false;
+    bool useMatPool = true;
+    string outputPath = defaultOutputPath();
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--source" && i + 1 < argc) {
+            source = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frameLimit = max(1, atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc && parseSize(argv[i + 1], sceneSize)) {
+            i++;
+        } else if (arg == "--display" && i + 1 < argc && parseSize(argv[i + 1], displaySize)) {
+            i++;
+        } else if (arg == "--roi" && i + 1 < argc) {
+            roiSize = max(8, atoi(argv[++i]));
+        } else if (arg == "--no-record") {
+            record = false;
+        } else if (arg == "--postprocess") {
+            postProcess = true;
+        } else if (arg == "--no-pool") {
+            useMatPool = false;
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [--source synthetic|FILE] [--frames N] [--size WxH] [--display WxH]"
+                 << " [--roi N] [--no-record] [--postprocess] [--no-pool] [--out FILE]" << endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (useMatPool) {
+        installMatPool();
+    }
+
+    ReplaySource replay;
+    if (source == "synthetic") {
+        SyntheticSceneOptions options;
+        options.frameSize = sceneSize;
+        options.keepDropHistory = false;
+        replay.synthetic.reset(new SyntheticDripSource(options));
+        replay.fps = options.fps;
+    } else {
+        if (!replay.capture.open(source)) {
+            cerr << "Failed to open " << source << endl;
+            return 1;
+        }
+        double fileFps = replay.capture.get(CAP_PROP_FPS);
+        replay.fps = fileFps > 0 ? fileFps : 30.0;
+    }
+    outputPath = filesystem::absolute(outputPath).string();
+
+    // Detection results, the post-processed recording and its catalog go to a scratch directory
+    ScratchDirectory scratch;
+    if (!enterScratchDirectory("frame_loop_bench", scratch)) {
+        return 1;
+    }
+
+    // UI laid out as in the application
+    DISPLAY_WIDTH = displaySize.width;
+    DISPLAY_HEIGHT = displaySize.height;
+    initializeUI(displaySize.width, displaySize.height);
+    initIR(bgSubControlsRect.x, bgSubControlsRect.y, bgSubControlsRect.width, bgSubControlsRect.height);
+    createArrowImages();
+    updateToggleButtonPosition(displaySize.width);
+    initFramePacing(replay.fps, false);
+    setSourceFrameRate(replay.fps);
+    startAllocTracking();
+    silenceApplicationLog();
+
+    // Recording started as the record button does it (post-processing expects /tmp/<date>_<time>_temp.avi)
+    if (record) {
+        tempFilename = "/tmp/" + formatWallClock("%Y%m%d_%H%M%S") + "_temp.avi";
+        recordingStartTime = steady_clock::now();
+        recordingDetectionEvents = 0;
+        isRecording = true;
+    }
+
+    Mat frame;
+    Mat uiFrame(displaySize, CV_8UC3, THEME_COLOR);
+    bool videoWriterInitialized = false;
+    steady_clock::time_point previousFrameTime = steady_clock::now();
+    steady_clock::time_point measureStart = previousFrameTime;
+    rusage usageStart;
+    getrusage(RUSAGE_SELF, &usageStart);
+    int framesRun = 0;
+    int framesMeasured = 0;
+
+    while (framesRun < WARMUP_FRAMES + frameLimit) {
+        if (framesRun == WARMUP_FRAMES) {
+            resetLatencyStats();
+            getrusage(RUSAGE_SELF, &usageStart);
+            measureStart = steady_clock::now();
+        }
+
+        steady_clock::time_point stageStart = startStage();
+        bool frameRead = replay.read(frame);
+        frameCaptureTime = steady_clock::now();
+        recordLatency(LATENCY_CAPTURE, stageStart);
+        if (!frameRead || frame.empty()) {
+            break;
+        }
+        updateOverlayClock();
+
+        if (isFirstFrame) {
+            frameSize = frame.size();
+            isFirstFrame = false;
+
+            // Detection box below the middle drop source of the synthetic scene
+            bgSubtractionRect = Rect(frame.cols / 2 - roiSize / 2, frame.rows / 3, roiSize, roiSize);
+            backgroundSubtractor = createBackgroundSubtractorMOG2(300, 16, true);
+            bgSubtractionActive = true;
+        }
+
+        // Detection runs for the whole replay instead of timing out after BG_SUB_TIMEOUT_SECONDS
+        bgSubStartTime = frameCaptureTime;
+        stageStart = startStage();
+        processBackgroundSubtraction(frame);
+        recordLatency(LATENCY_DETECTION, stageStart);
+
+        double avgFPS = calculateFPS(frameCaptureTime, previousFrameTime);
+
+        if (isRecording && !videoWriterInitialized) {
+            videoWriterInitialized = openRecordingWriter();
+        }
+        if (isRecording && videoWriterInitialized) {
+            stageStart = startStage();
+            videoWriterInitialized = writeRecordingFrame(frame, avgFPS);
+            recordLatency(LATENCY_RECORDING, stageStart);
+        }
+
+        stageStart = startStage();
+        renderPreview(frame, uiFrame, displaySize);
+        recordLatency(LATENCY_RESIZE, stageStart);
+
+        stageStart = startStage();
+        drawPreviewOverlays(uiFrame, displaySize.width, avgFPS);
+        recordLatency(LATENCY_OVERLAY, stageStart);
+
+        framesRun++;
+        if (framesRun > WARMUP_FRAMES) {
+            framesMeasured++;
+        }
+    }
+
+    double seconds = duration<double>(steady_clock::now() - measureStart).count();
+    rusage usageEnd;
+    getrusage(RUSAGE_SELF, &usageEnd);
+    double cpuPercent = seconds > 0 ? 100.0 * (cpuSeconds(usageEnd) - cpuSeconds(usageStart)) / seconds : 0;
+
+    long long recordingBytes = 0;
+    long long postProcessBytes = 0;
+    double postProcessSeconds = 0;
+    if (record) {
+        videoWriter.release();
+        isRecording = false;
+        recordingBytes = fileSize(tempFilename);
+        if (postProcess && recordingBytes > 0) {
+            // Source time, so the remuxed file plays at the replayed frame rate
+            recordingDurationSeconds = framesRun / replay.fps;
+            string outputName = tempFilename.substr(5, 14) + ".avi";
+            steady_clock::time_point processStart = steady_clock::now();
+            isProcessing = true;
+            postProcessVideo(tempFilename, recordingDurationSeconds, recordingDetectionEvents);
+            postProcessSeconds = duration<double>(steady_clock::now() - processStart).count();
+            postProcessBytes = fileSize(string(RECORDINGS_DIR) + outputName);
+        }
+        remove(tempFilename.c_str());
+    }
+
+    leaveScratchDirectory(scratch);
+
+    if (framesMeasured == 0) {
+        cerr << "No frames measured, the source has " << framesRun << " frames (" << WARMUP_FRAMES
+             << " are used for warm-up)" << endl;
+        return 1;
+    }
+
+    double fps = framesMeasured / seconds;
+    MatPoolStats poolStats = getMatPoolStats();
+    ofstream out(outputPath);
+    if (!out.is_open()) {
+        cerr << "Failed to write " << outputPath << endl;
+        return 1;
+    }
+    out << fixed << setprecision(3);
+    out << "{\n"
+        << "  \"source\": ";
+    writeJsonString(out, replay.synthetic ? string("synthetic") : filesystem::path(source).filename().string());
+    out << ",\n"
+        << "  \"frame_size\": [" << frameSize.width << ", " << frameSize.height << "],\n"
+        << "  \"display_size\": [" << displaySize.width << ", " << displaySize.height << "],\n"
+        << "  \"roi\": " << roiSize << ",\n"
+        << "  \"opencv\": \"" << CV_VERSION << "\",\n"
+        << "  \"cpus\": " << thread::hardware_concurrency() << ",\n"
+        << "  \"frames\": " << framesMeasured << ",\n"
+        << "  \"seconds\": " << seconds << ",\n"
+        << "  \"fps\": " << fps << ",\n"
+        << "  \"cpu_percent\": " << cpuPercent << ",\n"
+        << "  \"peak_rss_bytes\": " << usageEnd.ru_maxrss * 1024LL << ",\n"
+        << "  \"recording_bytes\": " << recordingBytes << ",\n"
+        << "  \"postprocess_bytes\": " << postProcessBytes << ",\n"
+        << "  \"bytes_written\": " << recordingBytes + postProcessBytes << ",\n"
+        << "  \"postprocess_seconds\": " << postProcessSeconds << ",\n"
+        << "  \"mat_pool\": " << (useMatPool ? "true" : "false") << ",\n"
+        << "  \"mat_pool_hits\": " << poolStats.hits << ",\n"
+        << "  \"mat_pool_misses\": " << poolStats.misses << ",\n"
+        << "  \"stages\": {";
+    bool firstStage = true;
+    for (LatencyStage stage : REPORTED_STAGES) {
+        LatencySummary summary = getLatencySummary(stage);
+        if (summary.count == 0) {
+            continue;
+        }
+        out << (firstStage ? "\n" : ",\n")
+            << "    \"" << latencyStageName(stage) << "\": {\"count\": " << summary.count
+            << ", \"mean_ms\": " << summary.meanMs << ", \"p50_ms\": " << summary.p50Ms
+            << ", \"p95_ms\": " << summary.p95Ms << ", \"p99_ms\": " << summary.p99Ms
+            << ", \"max_ms\": " << summary.maxMs
+            << ", \"allocations_per_frame\": " << summary.allocationsPerFrame
+            << ", \"bytes_per_frame\": " << summary.bytesPerFrame << "}";
+        firstStage = false;
+    }
+    out << "\n  }\n}\n";
+    out.close();
+
+    report << fixed << setprecision(1) << framesMeasured << " frames in " << seconds << " s: "
+           << fps << " fps, " << cpuPercent << "% CPU, peak RSS " << usageEnd.ru_maxrss / 1024 << " MB, "
+           << (recordingBytes + postProcessBytes) / (1024 * 1024) << " MB written" << endl;
+    report << "Results written to " << outputPath << endl;
+    return 0;
+}
@@ -0,0 +1,209 @@
+// Drives the application's serial layer (serial.cpp + serial worker) against
+// the VISCA simulator and reports command round-trip latency and zoom-hold
+// throughput. Runs on any Linux box, no camera needed:
+//   ./serial_bench [--iterations N] [--hold-seconds S] [--baud N]
+#include "common.h"
+#include "serial.h"
+#include "serial_worker.h"
+#include "camera_state.h"
+#include "visca_sim.h"
+#include "bench_util.h"
+
+// Globals the serial layer shares with the application. The config file is
+// written in the scratch directory once the simulator is up
+static const char* BENCH_CONFIG = "./serial_bench.ini";
+Config appConfig(BENCH_CONFIG, false);
+int zoomLevel = 0;
+int maxZoomLevel = 0x4000;
+int ZOOM_STEP = 512;
+int ZOOM_SPEED = 4;
+bool continuousZoom = false;
+atomic<bool> serialInitialized(false);
+bool icrModeEnabled = false;
+bool irCorrectionEnabled = false;
+bool isZoomInHeld = false;
+bool isZoomOutHeld = false;
+string logMessage;
+mutex logMutex;
+
+void setLogMessage(const string& message) {
+    lock_guard<mutex> lock(logMutex);
+    logMessage = message;
+}
+
+string getLogMessage() {
+    lock_guard<mutex> lock(logMutex);
+    return logMessage;
+}
+
+static bool waitFor(function<bool()> condition, int timeoutMs) {
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while (steady_clock::now() < deadline) {
+        if (condition()) {
+            return true;
+        }
+        this_thread::sleep_for(microseconds(200));
+    }
+    return condition();
+}
+
+static double percentile(vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    return values[min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5))];
+}
+
+static void printLatencies(const string& name, const vector<double>& samples, int failures) {
+    report << fixed << setprecision(2)
+         << name << ": n=" << samples.size()
+         << " min=" << percentile(samples, 0.0) << " ms"
+         << " p50=" << percentile(samples, 0.5) << " ms"
+         << " p95=" << percentile(samples, 0.95) << " ms"
+         << " max=" << percentile(samples, 1.0) << " ms";
+    if (failures > 0) {
+        report << " timeouts=" << failures;
+    }
+    report << endl;
+}
+
+// Command queued -> camera reports the new state through an inquiry
+static void measureRoundTrip(int iterations) {
+    vector<double> zoomSamples;
+    vector<double> icrSamples;
+    int zoomFailures = 0;
+    int icrFailures = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        // Small zoom moves, so lens travel time stays a minor part of the round trip
+        int target = (i % 2 == 0) ? 256 : 0;
+        steady_clock::time_point start = steady_clock::now();
+        sendZoomCommand(target);
+        if (waitFor([target] { return getCameraState().zoomPosition == target; }, 5000)) {
+            zoomSamples.push_back(duration<double, milli>(steady_clock::now() - start).count());
+        } else {
+            zoomFailures++;
+        }
+
+        bool enable = i % 2 == 0;
+        start = steady_clock::now();
+        sendICRCommand(enable);
+        if (waitFor([enable] { return getCameraState().icrMode == (enable ? 1 : 0); }, 5000)) {
+            icrSamples.push_back(duration<double, milli>(steady_clock::now() - start).count());
+        } else {
+            icrFailures++;
+        }
+    }
+
+    printLatencies("Zoom direct round trip", zoomSamples, zoomFailures);
+    printLatencies("ICR round trip", icrSamples, icrFailures);
+}
+
+// Stepped zoom hold as the UI does it: a new absolute target every ZOOM_DELAY_MS
+static void measureZoomHold(double holdSeconds, int stepIntervalMs) {
+    ViscaSimStats before = getViscaSimStats();
+    zoomLevel = 0;
+    bool zoomingIn = true;
+    int steps = 0;
+    steady_clock::time_point start = steady_clock::now();
+    steady_clock::time_point end = start + duration_cast<steady_clock::duration>(duration<double>(holdSeconds));
+    while (steady_clock::now() < end) {
+        // Sweep back and forth over the zoom range
+        if (zoomingIn && zoomLevel + ZOOM_STEP > maxZoomLevel) {
+            zoomingIn = false;
+        } else if (!zoomingIn && zoomLevel - ZOOM_STEP < 0) {
+            zoomingIn = true;
+        }
+        if (zoomingIn) {
+            zoomIn();
+        } else {
+            zoomOut();
+        }
+        steps++;
+        this_thread::sleep_for(milliseconds(stepIntervalMs));
+    }
+
+    // Time until the camera settles on the last target
+    int target = zoomLevel;
+    steady_clock::time_point released = steady_clock::now();
+    bool settled = waitFor([target] { return getCameraState().zoomPosition == target; }, 10000);
+    double settleMs = duration<double, milli>(steady_clock::now() - released).count();
+
+    ViscaSimStats after = getViscaSimStats();
+    double elapsed = duration<double>(released - start).count();
+    size_t sent = after.commands - before.commands;
+    report << fixed << setprecision(2)
+         << "Zoom hold (" << stepIntervalMs << " ms steps): " << steps << " steps, "
+         << sent << " commands sent (" << sent / elapsed << "/s), "
+         << steps - min<size_t>(steps, sent) << " coalesced, "
+         << after.bufferFull - before.bufferFull << " buffer full, "
+         << "settle ";
+    if (settled) {
+        report << settleMs << " ms" << endl;
+    } else {
+        report << "timeout" << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = 50;
+    double holdSeconds = 3.0;
+    ViscaSimOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = max(1, atoi(argv[++i]));
+        } else if (arg == "--hold-seconds" && i + 1 < argc) {
+            holdSeconds = atof(argv[++i]);
+        } else if (arg == "--baud" && i + 1 < argc) {
+            options.baudRate = atoi(argv[++i]);
+        } else {
+            cout << "Usage: " << argv[0] << " [--iterations N] [--hold-seconds S] [--baud N]" << endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    string devicePath;
+    if (!startViscaSimulator(options, devicePath)) {
+        return 1;
+    }
+
+    // Point the serial layer at the simulator
+    ScratchDirectory scratch;
+    if (!enterScratchDirectory("serial_bench", scratch)) {
+        stopViscaSimulator();
+        return 1;
+    }
+    {
+        ofstream config(BENCH_CONFIG);
+        config << "SERIAL_PORT = " << devicePath << "\n";
+    }
+    appConfig.loadConfig();
+
+    startSerialWorker();
+    if (!waitFor([] { return serialInitialized.load(); }, 5000) ||
+        !waitFor([] { return getCameraState().zoomPosition >= 0; }, 5000)) {
+        cerr << "Serial layer did not connect to the simulator on " << devicePath << endl;
+        stopSerialWorker();
+        stopViscaSimulator();
+        leaveScratchDirectory(scratch);
+        return 1;
+    }
+    report << "Simulator on " << devicePath << ", " << options.baudRate << " baud" << endl;
+    silenceApplicationLog();
+
+    measureRoundTrip(iterations);
+    measureZoomHold(holdSeconds, 100);
+    measureZoomHold(holdSeconds, 10);
+
+    stopSerialWorker();
+    stopViscaSimulator();
+    leaveScratchDirectory(scratch);
+
+    ViscaSimStats stats = getViscaSimStats();
+    report << "Simulator totals: " << stats.commands << " commands, " << stats.inquiries
+         << " inquiries, " << stats.errors << " errors" << endl;
+    return 0;
+}
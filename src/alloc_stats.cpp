@@ -0,0 +1,102 @@
+#include "alloc_stats.h"
+#include "mat_pool.h"
+#include <new>
+#include <cstdlib>
+
+atomic<bool> allocTrackingEnabled(false);
+
+// Plain thread-local counters, no synchronization on the allocation path
+static thread_local uint64_t threadAllocations = 0;
+static thread_local uint64_t threadAllocatedBytes = 0;
+
+static inline void countAllocation(size_t size) {
+    if (allocTrackingEnabled.load(memory_order_relaxed)) {
+        threadAllocations++;
+        threadAllocatedBytes += size;
+    }
+}
+
+void* operator new(size_t size) {
+    countAllocation(size);
+    while (true) {
+        if (void* block = malloc(size ? size : 1)) {
+            return block;
+        }
+        new_handler handler = get_new_handler();
+        if (!handler) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+// Mat buffers come from fastMalloc, not operator new; count them in the
+// default allocator and leave the allocation itself to OpenCV's
+class TrackingMatAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                       AccessFlag flags, UMatUsageFlags usageFlags) const override {
+        UMatData* u = Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (u) {
+            if (!data) {
+                countAllocation(u->size);
+            }
+            // Release through this allocator too
+            u->prevAllocator = u->currAllocator = this;
+        }
+        return u;
+    }
+
+    bool allocate(UMatData* u, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override {
+        return Mat::getStdAllocator()->allocate(u, accessFlags, usageFlags);
+    }
+
+    void deallocate(UMatData* u) const override {
+        Mat::getStdAllocator()->deallocate(u);
+    }
+};
+
+static TrackingMatAllocator trackingAllocator;
+static once_flag allocatorInstalled;
+
+AllocCount threadAllocCount() {
+    return AllocCount{threadAllocations, threadAllocatedBytes};
+}
+
+void countHeapAllocation(size_t bytes) {
+    countAllocation(bytes);
+}
+
+void startAllocTracking() {
+    // Mats created before keep the allocator they were made with
+    call_once(allocatorInstalled, [] {
+        if (!isMatPoolInstalled()) {
+            Mat::setDefaultAllocator(&trackingAllocator);
+        }
+    });
+    allocTrackingEnabled.store(true);
+}
+
+void stopAllocTracking() {
+    allocTrackingEnabled.store(false);
+}
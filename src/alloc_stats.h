@@ -0,0 +1,29 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include "common.h"
+
+// Heap allocation counting, off unless enabled (ALLOC_STATS or the 'a' key).
+// operator new and the default Mat allocator are hooked; each thread counts
+// its own allocations, so background threads do not show up in the main
+// loop stages. Aligned operator new is not counted.
+extern atomic<bool> allocTrackingEnabled;
+
+// Allocations made by the calling thread while tracking was on
+struct AllocCount {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+AllocCount threadAllocCount();
+
+// Count an allocation made outside operator new (Mat buffers from fastMalloc)
+void countHeapAllocation(size_t bytes);
+
+// Start counting (installs the Mat allocator hook on first use, unless the
+// Mat pool is the default allocator and counts its own misses)
+void startAllocTracking();
+
+void stopAllocTracking();
+
+#endif // ALLOC_STATS_H
@@ -1,7 +1,30 @@
 #include "background_subtraction.h"
+#include "metrics.h"
+#include "clock_service.h"
 #include <fstream>
 #include <algorithm>
 
+// Kept between frames so detection reuses the same buffers; after the first
+// frames neither the mask nor the contour storage needs new memory
+static Mat foregroundMask;
+static vector<vector<Point>> contours;
+static vector<DropDetection> detections;
+static string statusText;
+
+// Built once; an empty kernel makes erode/dilate build a rect kernel each call
+static const Mat ERODE_KERNEL = getStructuringElement(MORPH_RECT, Size(3, 3));
+static const Mat DILATE_KERNEL = getStructuringElement(MORPH_RECT, Size(5, 5));
+
+void cleanForegroundMask(Mat& mask) {
+    // Thresholding to get binary mask
+    threshold(mask, mask, 250, 255, THRESH_BINARY);
+    
+    // Morphological operations to remove noise (a 3x3 erode, then the
+    // 5x5 that two 3x3 dilations amount to)
+    erode(mask, mask, ERODE_KERNEL);
+    dilate(mask, mask, DILATE_KERNEL);
+}
+
 void initBgSubControls(int controlsX, int controlsY, int controlsWidth, int controlsHeight) {
     bgSubControlsRect = Rect(controlsX, controlsY, controlsWidth, controlsHeight);
     
@@ -65,7 +88,10 @@ void drawDualRangeSlider(Mat& img, Rect sliderRect, int& minValue, int& maxValue
               Scalar(200, 200, 200), 2); // Thicker border
     
     // Display current values with LARGER FONT and more SPACE below
-    string valueText = "Min: " + to_string(minValue) + " - Max: " + to_string(maxValue);
+    static string valueText;
+    char valueBuffer[48];
+    snprintf(valueBuffer, sizeof(valueBuffer), "Min: %d - Max: %d", minValue, maxValue);
+    valueText.assign(valueBuffer);
     putText(img, valueText, 
             Point(sliderRect.x + sliderRect.width/2 - 80, sliderRect.y + sliderRect.height + 25), // Lower position
             FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2); // Increased size and thickness
@@ -156,14 +182,6 @@ void drawDetectionResults(Mat& frame) {
     }
 }
 
-std::string getTimestampString() {
-    auto now = std::chrono::system_clock::now();
-    auto nowTime = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&nowTime), "%Y%m%d_%H%M%S");
-    return ss.str();
-}
-
 void saveTopDetectionPoints(int topCount) {
     // Convert map to vector for sorting
     std::vector<std::pair<Point, int>> countVector;
@@ -180,7 +198,7 @@ void saveTopDetectionPoints(int topCount) {
               });
     
     // Create filename with timestamp
-    std::string timestamp = getTimestampString();
+    std::string timestamp = formatWallClock("%Y%m%d_%H%M%S");
     std::string filename = "./drip_detect/detection_results_" + timestamp + ".csv";
     
     // Create directory if it doesn't exist
@@ -235,14 +253,63 @@ void saveTopDetectionPoints(int topCount) {
     }
 }
 
+void filterContours(const vector<vector<Point>>& contours, Point offset,
+                    vector<DropDetection>& detections) {
+    detections.clear();
+    for (const auto& contour : contours) {
+        double area = contourArea(contour);
+        
+        // Filter contours by area
+        if (area > lowerBound && area < upperBound) {
+            Rect boundingBox = boundingRect(contour);
+            
+            // Adjust coordinates to frame coordinates
+            boundingBox.x += offset.x;
+            boundingBox.y += offset.y;
+            
+            // Store occurrence, keyed by position
+            objectOccurrences[boundingBox.tl()].emplace_back(frameNumber, float(area));
+            detections.push_back(DropDetection{boundingBox, area});
+        }
+    }
+}
+
+void addDetectionPoint(const Point& detectionPoint) {
+    // Check if this point is similar to any existing point
+    Point existingPoint = findSimilarPoint(detectionPoint, detectionPoints);
+
+    if (existingPoint.x == -1) {
+        // No similar point found, add new point
+        detectionCounts[detectionPoint] = 1;
+        detectionPoints.push_back(detectionPoint);
+
+        // A new drop point is one drop event; later frames of it are not
+        countMetric(METRIC_DETECTIONS);
+        if (isRecording) {
+            recordingDetectionEvents++;
+        }
+    } else {
+        // Similar point found, update existing point
+        detectionCounts[existingPoint]++;
+    }
+}
+
+void resetDetectionState() {
+    frameNumber = 0;
+    objectOccurrences.clear();
+    detectionPoints.clear();
+    detectionCounts.clear();
+    isTimedOut = false;
+}
+
 void processBackgroundSubtraction(Mat& frame) {
     if (!bgSubtractionActive || bgSubtractionRect.width <= 0 || bgSubtractionRect.height <= 0) {
         return;
     }
     
     // Check for timeout
-    auto currentTime = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed = currentTime - bgSubStartTime;
+    // Measured between capture stamps, so wall-clock steps do not shorten or extend it
+    duration<double> elapsed = frameCaptureTime - bgSubStartTime;
     int remainingSeconds = BG_SUB_TIMEOUT_SECONDS - static_cast<int>(elapsed.count());
     
     // If time is up and not already processed
@@ -276,76 +343,38 @@ void processBackgroundSubtraction(Mat& frame) {
     Mat roi = frame(safeRect);
     
     // Apply background subtraction
-    Mat foregroundMask;
     backgroundSubtractor->apply(roi, foregroundMask);
-    
-    // Thresholding to get binary mask
-    threshold(foregroundMask, foregroundMask, 250, 255, THRESH_BINARY);
-    
-    // Morphological operations to remove noise
-    Mat kernel;
-    erode(foregroundMask, foregroundMask, kernel, Point(-1,-1), 1);
-    dilate(foregroundMask, foregroundMask, kernel, Point(-1,-1), 2);
+    cleanForegroundMask(foregroundMask);
     
     // Find contours
-    vector<vector<Point>> contours;
     findContours(foregroundMask, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
     
     // Display contours count and remaining time
-    putText(frame, "Contours: " + to_string(contours.size()) + " | Time left: " + to_string(remainingSeconds) + "s", 
+    char statusBuffer[64];
+    snprintf(statusBuffer, sizeof(statusBuffer), "Contours: %zu | Time left: %ds",
+             contours.size(), remainingSeconds);
+    statusText.assign(statusBuffer);
+    putText(frame, statusText, 
             Point(safeRect.x, safeRect.y - 10), 
             FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 1);
     
     // Process contours
-    for (const auto& contour : contours) {
-        double area = contourArea(contour);
-        
-        // Filter contours by area
-        if (area > lowerBound && area < upperBound) {
-            Rect boundingBox = boundingRect(contour);
-            
-            // Adjust coordinates to frame coordinates
-            int x = boundingBox.x + safeRect.x;
-            int y = boundingBox.y + safeRect.y;
-            
-            // Create unique object ID based on position
-            string objectId = "object_" + to_string(x) + "_" + to_string(y);
-            
-            // Store occurrence
-            if (objectOccurrences.find(objectId) == objectOccurrences.end()) {
-                std::map<int, float> frameData;
-                frameData[frameNumber] = area;
-                objectOccurrences[objectId] = {frameData};
-            } else {
-                std::map<int, float> frameData;
-                frameData[frameNumber] = area;
-                objectOccurrences[objectId].push_back(frameData);
-            }
-            
-            // Draw rectangle on the original frame (adjusted to frame coordinates)
-            rectangle(frame, 
-                     Rect(x - 4, y - 4, boundingBox.width + 8, boundingBox.height + 8), 
-                     Scalar(0, 0, 255), 1);
-            
-            // Draw label
-            putText(frame, "drop", Point(x, y - 10), 
-                    FONT_HERSHEY_SIMPLEX, 0.3, Scalar(0, 255, 0), 1);
-            
-            // Store detection point
-            Point detectionPoint(x, y);
-
-            // Check if this point is similar to any existing point
-            Point existingPoint = findSimilarPoint(detectionPoint, detectionPoints);
+    filterContours(contours, safeRect.tl(), detections);
+    for (const DropDetection& detection : detections) {
+        int x = detection.box.x;
+        int y = detection.box.y;
 
-            if (existingPoint.x == -1) {
-                // No similar point found, add new point
-                detectionCounts[detectionPoint] = 1;
-                detectionPoints.push_back(detectionPoint);
-            } else {
-                // Similar point found, update existing point
-                detectionCounts[existingPoint]++;
-            }
-        }
+        // Draw rectangle on the original frame (adjusted to frame coordinates)
+        rectangle(frame, 
+                 Rect(x - 4, y - 4, detection.box.width + 8, detection.box.height + 8), 
+                 Scalar(0, 0, 255), 1);
+        
+        // Draw label
+        putText(frame, "drop", Point(x, y - 10), 
+                FONT_HERSHEY_SIMPLEX, 0.3, Scalar(0, 255, 0), 1);
+        
+        // Store detection point
+        addDetectionPoint(Point(x, y));
     }
     
     // Draw the detection results
@@ -365,8 +394,9 @@ void drawBgSubControls(Mat& uiFrame, bool bgSubtractionActive) {
         rectangle(uiFrame, bgSubControlsRect, Scalar(100, 150, 100), 2);
         
         // Draw dual range slider for contour area
+        static const string sliderLabel = "Contour Area Range";
         drawDualRangeSlider(uiFrame, bgSubSliderRect, lowerBound, upperBound, 
-                        minContourArea, maxContourArea, "Contour Area Range");
+                        minContourArea, maxContourArea, sliderLabel);
         
         if (bgSubtractionActive) {
             // Overlay if controls are disabled
@@ -12,6 +12,28 @@ void updateBgSubControlsTogglePosition(bool showControls);
 // Process background subtraction on current frame
 void processBackgroundSubtraction(Mat& frame);
 
+// Threshold and denoise a MOG2 foreground mask in place
+void cleanForegroundMask(Mat& mask);
+
+// A contour that passed the area filter, in frame coordinates
+struct DropDetection {
+    Rect box;
+    double area;
+};
+
+// Keep the contours with an area between lowerBound and upperBound and record
+// each in objectOccurrences for the current frame; offset moves the contours
+// from ROI into frame coordinates
+void filterContours(const vector<vector<Point>>& contours, Point offset,
+                    vector<DropDetection>& detections);
+
+// Count a detection at the drop point within a pixel of it, or add it as a
+// new drop point (one drop event for the metrics and the recording)
+void addDetectionPoint(const Point& point);
+
+// Clear the results and the frame counter for a new detection session
+void resetDetectionState();
+
 // Draw background subtraction controls on UI
 void drawBgSubControls(Mat& uiFrame, bool bgSubtractionActive);
 
@@ -1,32 +1,48 @@
 #include "camera.h"
+#include "latency_stats.h"
+#include "metrics.h"
+#include "synthetic_source.h"
 
-double calculateFPS(system_clock::time_point& previousFrameTime) {
-    auto currentFrameTime = system_clock::now();
-    duration<double> elapsed = currentFrameTime - previousFrameTime;
-    previousFrameTime = currentFrameTime;
-    return 1.0 / elapsed.count();
-}
+// Recent frame intervals in seconds, a fixed ring so the history never allocates
+static const int FPS_HISTORY_SIZE = 30;
+static double fpsHistory[FPS_HISTORY_SIZE];
+static int fpsHistoryStart = 0;
+static int fpsHistoryCount = 0;
+
+// Period of the open frame source, the gap that counts as one frame
+static double sourceFrameSeconds = 1.0 / 30.0;
 
-string getCurrentTimeStr() {
-    auto now = system_clock::now();
-    time_t now_c = system_clock::to_time_t(now);
-    struct tm* timeinfo = localtime(&now_c);
-    char buffer[80];
-    strftime(buffer, 80, "%H:%M:%S", timeinfo);
-    stringstream ss;
-    ss << buffer;
-    return ss.str();
+void setSourceFrameRate(double fps) {
+    sourceFrameSeconds = 1.0 / (fps > 0 ? fps : 30.0);
 }
 
-string getCurrentDateStr() {
-    auto now = system_clock::now();
-    time_t now_c = system_clock::to_time_t(now);
-    struct tm* timeinfo = localtime(&now_c);
-    char buffer[80];
-    strftime(buffer, 80, "%Y-%m-%d", timeinfo);
-    stringstream ss;
-    ss << buffer;
-    return ss.str();
+double calculateFPS(steady_clock::time_point captureTime, steady_clock::time_point& previousFrameTime) {
+    static double historySeconds = 0;
+
+    steady_clock::duration elapsed = captureTime - previousFrameTime;
+    previousFrameTime = captureTime;
+    recordLatency(LATENCY_FRAME, elapsed);
+    recordFrameAllocations();
+
+    // fpsHistory holds frame intervals with a running total, so the
+    // average is frames over time instead of a mean of rates
+    double seconds = duration<double>(elapsed).count();
+
+    // A gap of more than one and a half frame periods means the camera
+    // delivered frames that were never read
+    double periods = seconds / sourceFrameSeconds;
+    if (fpsHistoryCount > 0 && periods >= 1.5) {
+        countMetric(METRIC_FRAMES_DROPPED, uint64_t(periods + 0.5) - 1);
+    }
+    if (fpsHistoryCount == FPS_HISTORY_SIZE) {
+        historySeconds -= fpsHistory[fpsHistoryStart];
+        fpsHistoryStart = (fpsHistoryStart + 1) % FPS_HISTORY_SIZE;
+        fpsHistoryCount--;
+    }
+    fpsHistory[(fpsHistoryStart + fpsHistoryCount) % FPS_HISTORY_SIZE] = seconds;
+    fpsHistoryCount++;
+    historySeconds += seconds;
+    return historySeconds > 0 ? fpsHistoryCount / historySeconds : 0.0;
 }
 
 void cameraConfig(VideoCapture* cap) {
@@ -53,3 +69,89 @@ void cameraConfig(VideoCapture* cap) {
     cout << "Camera FPS: " << cap->get(CAP_PROP_FPS) << endl;
     return;
 }
+
+// Set when FRAME_SOURCE is not the camera
+static unique_ptr<SyntheticDripSource> syntheticSource;
+static bool playingFile = false;
+static double fileFrameSeconds = 0;
+static steady_clock::time_point nextFileFrame;
+
+bool openFrameSource(VideoCapture* cap, const string& source, double& sourceFPS) {
+    sourceFPS = 30.0;
+    if (source.empty()) {
+        cameraConfig(cap);
+        if (!cap->isOpened()) {
+            return false;
+        }
+        // The driver may settle on a lower rate than the 30 fps requested
+        double cameraFPS = cap->get(CAP_PROP_FPS);
+        if (cameraFPS > 0) {
+            sourceFPS = cameraFPS;
+        }
+        setSourceFrameRate(sourceFPS);
+        return true;
+    }
+
+    if (source == "synthetic") {
+        SyntheticSceneOptions options;
+        options.frameSize = Size(WIDTH, HEIGHT);
+        options.realTime = true;
+        options.keepDropHistory = false;
+        syntheticSource.reset(new SyntheticDripSource(options));
+        sourceFPS = options.fps;
+        setSourceFrameRate(sourceFPS);
+        cout << "Frame source: synthetic drip scene " << WIDTH << "x" << HEIGHT << endl;
+        return true;
+    }
+
+    if (!cap->open(source)) {
+        cerr << "ERROR: Unable to open video file " << source << endl;
+        setLogMessage("Error");
+        return false;
+    }
+    double fps = cap->get(CAP_PROP_FPS);
+    playingFile = true;
+    fileFrameSeconds = 1.0 / (fps > 0 ? fps : 30.0);
+    sourceFPS = 1.0 / fileFrameSeconds;
+    setSourceFrameRate(sourceFPS);
+    nextFileFrame = steady_clock::now();
+    cout << "Frame source: " << source << " at " << 1.0 / fileFrameSeconds << " fps" << endl;
+    return true;
+}
+
+// A driver timestamp further from now than this is not trusted
+static const steady_clock::duration MAX_BUFFER_STAMP_AGE = seconds(1);
+
+bool readFrame(VideoCapture* cap, Mat& frame, steady_clock::time_point& captureTime) {
+    if (syntheticSource) {
+        bool frameRead = syntheticSource->read(frame);
+        captureTime = steady_clock::now();
+        return frameRead;
+    }
+    if (playingFile) {
+        // Deliver frames at the file's rate, the way the camera would,
+        // stamped with the time they were due
+        this_thread::sleep_until(nextFileFrame);
+        captureTime = nextFileFrame;
+        nextFileFrame += duration_cast<steady_clock::duration>(duration<double>(fileFrameSeconds));
+        return cap->read(frame);
+    }
+
+    if (!cap->read(frame)) {
+        return false;
+    }
+    captureTime = steady_clock::now();
+
+    // V4L2 stamps each buffer when the driver fills it, on CLOCK_MONOTONIC,
+    // the clock steady_clock reads; use that when it looks valid so frames
+    // that waited in the queue keep the time they were actually captured
+    double bufferMs = cap->get(CAP_PROP_POS_MSEC);
+    if (bufferMs > 0) {
+        steady_clock::time_point bufferTime(
+            duration_cast<steady_clock::duration>(duration<double, std::milli>(bufferMs)));
+        if (bufferTime <= captureTime && captureTime - bufferTime < MAX_BUFFER_STAMP_AGE) {
+            captureTime = bufferTime;
+        }
+    }
+    return true;
+}
@@ -6,13 +6,20 @@
 // Configure the camera
 void cameraConfig(VideoCapture* cap);
 
-// Calculate current FPS
-double calculateFPS(system_clock::time_point& previousFrameTime);
+// Open the frame source named by FRAME_SOURCE: "" for the camera, "synthetic"
+// for a generated drip scene, anything else is a video file played in real time.
+// sourceFPS is the rate frames will actually arrive at (30 when unknown)
+bool openFrameSource(VideoCapture* cap, const string& source, double& sourceFPS);
 
-// Get current time as string
-string getCurrentTimeStr();
+// Next frame from the open source, with the steady_clock time it was
+// captured (the V4L2 buffer timestamp when the driver provides one)
+bool readFrame(VideoCapture* cap, Mat& frame, steady_clock::time_point& captureTime);
 
-// Get current date as string
-string getCurrentDateStr();
+// Frame rate calculateFPS measures dropped frames against; openFrameSource
+// sets it, callers feeding frames some other way set it themselves
+void setSourceFrameRate(double fps);
+
+// Average FPS over the last FPS_HISTORY_SIZE frames, from their capture times
+double calculateFPS(steady_clock::time_point captureTime, steady_clock::time_point& previousFrameTime);
 
 #endif // CAMERA_H
@@ -0,0 +1,80 @@
+#include "camera_state.h"
+
+static atomic<int> cameraZoomPosition(-1);
+static atomic<int> cameraICRMode(-1);
+static atomic<int> cameraIRCorrection(-1);
+static atomic<int> cameraLastError(0);
+static atomic<unsigned int> cameraStateVersion(0);
+
+// Last values applied to the UI, so only camera-side changes are synced
+static unsigned int syncedVersion = 0;
+static int syncedZoomPosition = -1;
+static int syncedICRMode = -1;
+static int syncedIRCorrection = -1;
+
+static void touchCameraState() {
+    cameraStateVersion++;
+}
+
+CameraState getCameraState() {
+    CameraState state;
+    state.version = cameraStateVersion.load();
+    state.zoomPosition = cameraZoomPosition.load();
+    state.icrMode = cameraICRMode.load();
+    state.irCorrection = cameraIRCorrection.load();
+    state.lastError = cameraLastError.load();
+    return state;
+}
+
+void updateCameraZoomPosition(int position) {
+    cameraZoomPosition = position;
+    touchCameraState();
+}
+
+void updateCameraICRMode(bool enabled) {
+    cameraICRMode = enabled ? 1 : 0;
+    touchCameraState();
+}
+
+void updateCameraIRCorrection(bool enabled) {
+    cameraIRCorrection = enabled ? 1 : 0;
+    touchCameraState();
+}
+
+void updateCameraError(int errorCode) {
+    cameraLastError = errorCode;
+    touchCameraState();
+}
+
+void resetCameraState() {
+    cameraZoomPosition = -1;
+    cameraICRMode = -1;
+    cameraIRCorrection = -1;
+    cameraLastError = 0;
+    cameraStateVersion++;
+}
+
+void syncCameraStateToUI() {
+    CameraState state = getCameraState();
+    if (state.version == syncedVersion) {
+        return;
+    }
+    syncedVersion = state.version;
+
+    if (state.icrMode >= 0 && state.icrMode != syncedICRMode) {
+        icrModeEnabled = state.icrMode == 1;
+    }
+    syncedICRMode = state.icrMode;
+
+    if (state.irCorrection >= 0 && state.irCorrection != syncedIRCorrection) {
+        irCorrectionEnabled = state.irCorrection == 1;
+    }
+    syncedIRCorrection = state.irCorrection;
+
+    // While a zoom button is held the UI leads; afterwards follow the camera
+    if (state.zoomPosition >= 0 && state.zoomPosition != syncedZoomPosition &&
+        !isZoomInHeld && !isZoomOutHeld) {
+        zoomLevel = state.zoomPosition;
+        syncedZoomPosition = state.zoomPosition;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef CAMERA_STATE_H
+#define CAMERA_STATE_H
+
+#include "common.h"
+
+// Last camera state reported by VISCA inquiries (-1 = not known yet)
+struct CameraState {
+    int zoomPosition;
+    int icrMode;            // 1 = ICR (night) mode on
+    int irCorrection;       // 1 = IR light correction
+    int lastError;          // last VISCA error code, 0 if none
+    unsigned int version;   // changes whenever any field is updated
+};
+
+// Read the cached state (lock-free, safe from any thread)
+CameraState getCameraState();
+
+// Updates from the serial worker
+void updateCameraZoomPosition(int position);
+void updateCameraICRMode(bool enabled);
+void updateCameraIRCorrection(bool enabled);
+void updateCameraError(int errorCode);
+
+// Forget everything (camera disconnected)
+void resetCameraState();
+
+// Bring the UI in line with changes reported by the camera (main loop)
+void syncCameraStateToUI();
+
+#endif // CAMERA_STATE_H
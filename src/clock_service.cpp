@@ -0,0 +1,80 @@
+#include "clock_service.h"
+
+static const int TIMESTAMP_FONT = FONT_HERSHEY_SIMPLEX;
+static const double TIMESTAMP_FONT_SCALE = 0.7;
+static const int TIMESTAMP_THICKNESS = 2;
+
+static string overlayTimestamp;
+static steady_clock::time_point nextRefresh;
+
+// Text pixels of overlayTimestamp, where its origin lies in the mask, and its width
+static Mat timestampMask;
+static Point maskOrigin;
+static int timestampWidth = 0;
+
+static void renderTimestamp() {
+    int baseline = 0;
+    Size textSize = getTextSize(overlayTimestamp, TIMESTAMP_FONT, TIMESTAMP_FONT_SCALE,
+                                TIMESTAMP_THICKNESS, &baseline);
+    timestampWidth = textSize.width;
+
+    // Padding for the strokes, which reach past the glyph boxes
+    int pad = TIMESTAMP_THICKNESS;
+    timestampMask.create(textSize.height + baseline + 2 * pad, textSize.width + 2 * pad, CV_8UC1);
+    timestampMask.setTo(Scalar(0));
+    maskOrigin = Point(pad, pad + textSize.height);
+    putText(timestampMask, overlayTimestamp, maskOrigin, TIMESTAMP_FONT, TIMESTAMP_FONT_SCALE,
+            Scalar(255), TIMESTAMP_THICKNESS);
+}
+
+void updateOverlayClock() {
+    steady_clock::time_point now = steady_clock::now();
+    if (now < nextRefresh && !timestampMask.empty()) {
+        return;
+    }
+
+    system_clock::time_point wallNow = system_clock::now();
+    time_t wallSeconds = system_clock::to_time_t(wallNow);
+    struct tm timeinfo;
+    localtime_r(&wallSeconds, &timeinfo);
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    overlayTimestamp.assign(buffer);
+    renderTimestamp();
+
+    // Refresh again when the wall clock reaches its next second
+    steady_clock::duration intoSecond =
+        duration_cast<steady_clock::duration>(wallNow - system_clock::from_time_t(wallSeconds));
+    if (intoSecond < steady_clock::duration::zero() || intoSecond >= seconds(1)) {
+        intoSecond = steady_clock::duration::zero();
+    }
+    nextRefresh = now + (seconds(1) - intoSecond);
+}
+
+const string& getOverlayTimestamp() {
+    return overlayTimestamp;
+}
+
+int drawOverlayTimestamp(Mat& img, Point origin, const Scalar& color) {
+    if (timestampMask.empty()) {
+        return origin.x;
+    }
+
+    // Only the part of the mask that lands inside the image
+    Rect target(origin.x - maskOrigin.x, origin.y - maskOrigin.y, timestampMask.cols, timestampMask.rows);
+    Rect visible = target & Rect(0, 0, img.cols, img.rows);
+    if (visible.width > 0 && visible.height > 0) {
+        Rect maskPart(visible.x - target.x, visible.y - target.y, visible.width, visible.height);
+        img(visible).setTo(color, timestampMask(maskPart));
+    }
+    return origin.x + timestampWidth;
+}
+
+string formatWallClock(const char* format) {
+    time_t now = time(0);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    char buffer[128];
+    strftime(buffer, sizeof(buffer), format, &timeinfo);
+    return buffer;
+}
@@ -0,0 +1,26 @@
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include "common.h"
+
+// Wall-clock text for the overlays. The date and time are formatted, and the
+// text rendered into a mask, at most once a second; the preview and the
+// recording both draw that cached copy, so they show the same timestamp for
+// a frame. When to refresh is timed on steady_clock, so only the displayed
+// text follows the wall clock.
+
+// Latch the clock for the current frame; call once per frame after capture
+void updateOverlayClock();
+
+// "YYYY-MM-DD HH:MM:SS" as of the last update
+const string& getOverlayTimestamp();
+
+// Draw the latched timestamp as putText would with FONT_HERSHEY_SIMPLEX, 0.7,
+// thickness 2 (origin is the bottom-left of the text); returns the x where
+// text following it would start
+int drawOverlayTimestamp(Mat& img, Point origin, const Scalar& color);
+
+// Current wall-clock time in strftime format, for file names
+string formatWallClock(const char* format);
+
+#endif // CLOCK_SERVICE_H
@@ -32,11 +32,6 @@ struct PointCompare {
     }
 };
 
-extern Rect consFramesSliderRect;        // Slider area for consecutive frames
-extern bool isDraggingConsFramesHandle;
-extern int minConsFrames;           // Minimum value for consecutive frames
-extern int maxConsFrames;          // Maximum value for consecutive frames
-
 extern bool showBgSubControls;  // Flag to show/hide the contour range slider
 extern int minContourArea;        // Min contour area value (default 50)
 extern int maxContourArea;       // Max contour area value (default 200)
@@ -51,15 +46,12 @@ extern bool isDraggingMaxHandle;
 extern bool bgSubtractionActive;
 extern Rect bgSubtractionRect;
 extern Ptr<BackgroundSubtractorMOG2> backgroundSubtractor;
-extern std::map<std::string, std::vector<std::map<int, float>>> objectOccurrences;
+extern std::map<cv::Point, std::vector<std::pair<int, float>>, PointCompare> objectOccurrences;  // (frame, area) per position
 extern int frameNumber;
 extern std::vector<cv::Point> detectionPoints;
 extern std::map<cv::Point, int, PointCompare> detectionCounts;
-extern int REQUIRED_CONSECUTIVE_FRAMES;  // Configurable: number of consecutive frames required
-extern std::map<cv::Point, int, PointCompare> consecutiveDetections;  // Track consecutive detections
-extern std::map<cv::Point, int, PointCompare> lastFrameDetected;      // Track when point was last detected
 
-extern std::chrono::time_point<std::chrono::system_clock> bgSubStartTime;
+extern steady_clock::time_point bgSubStartTime;  // Capture time of the first detection frame
 extern const int BG_SUB_TIMEOUT_SECONDS;
 extern bool isTimedOut;
 
@@ -100,9 +92,9 @@ extern string filename;
 extern string tempFilename;
 extern bool isFirstFrame;
 extern Size frameSize;
-extern deque<double> fpsHistory;
-extern const int FPS_HISTORY_SIZE;
-extern system_clock::time_point recordingStartTime;
+extern steady_clock::time_point frameCaptureTime;    // When the frame being processed was captured
+extern steady_clock::time_point recordingStartTime;  // Capture time of the first recorded frame
+extern int recordingDetectionEvents;   // New drop points found during the current recording
 extern int WIDTH;
 extern int HEIGHT;
 extern int DISPLAY_WIDTH;
@@ -123,13 +115,18 @@ extern int zoomLevel;
 extern int maxZoomLevel;
 extern Rect zoomInButtonRect;
 extern Rect zoomOutButtonRect;
-extern bool serialInitialized;
+extern atomic<bool> serialInitialized;
 
 // Button holding state variables
 extern bool isZoomInHeld;
 extern bool isZoomOutHeld;
-extern system_clock::time_point lastZoomTime;
+extern steady_clock::time_point lastZoomTime;
 extern int ZOOM_DELAY_MS;
+extern int ZOOM_STEP;
+
+// Continuous zoom: one variable-speed command per press instead of repeated steps
+extern bool continuousZoom;
+extern int ZOOM_SPEED;
 
 // Display options
 extern bool showFPS;
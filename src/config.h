@@ -6,31 +6,225 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include "config_schema.h"
 
 using namespace std;
 
-// Configuration class to handle loading and saving settings
+// Immutable set of settings parsed from the config file
+struct ConfigSnapshot {
+    map<string, string> raw;    // key/value pairs as written in the file
+    Settings values;            // typed values, validated against the schema
+};
+
+// Configuration class to handle loading and saving settings.
+// The file is parsed once into a snapshot that is published atomically;
+// readers only load a pointer, reloads swap in a new snapshot.
 class Config {
 private:
     string configFilePath;
-    map<string, string> settings;
+    atomic<const ConfigSnapshot*> current;
+
+    // The last few snapshots are kept alive, a reader may still hold a reference
+    // to one; references must not be held across more than that many reloads
+    static const size_t KEPT_SNAPSHOTS = 8;
+    mutex snapshotMutex;
+    vector<unique_ptr<const ConfigSnapshot>> snapshots;
+
+    // Change notification, delivered on the main loop by dispatchChanges()
+    mutex subscriberMutex;
+    vector<function<void(const Config&)>> subscribers;
+    atomic<bool> changePending;
+
+    static bool parseValue(string value, bool& result) {
+        // Convert to lowercase for case-insensitive comparison
+        transform(value.begin(), value.end(), value.begin(), ::tolower);
+        if (value == "true" || value == "yes" || value == "1") {
+            result = true;
+            return true;
+        } else if (value == "false" || value == "no" || value == "0") {
+            result = false;
+            return true;
+        }
+        return false;
+    }
+
+    static bool parseValue(const string& value, int& result) {
+        char* end = nullptr;
+        long parsed = strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            return false;
+        }
+        result = static_cast<int>(parsed);
+        return true;
+    }
+
+    static bool parseValue(const string& value, double& result) {
+        char* end = nullptr;
+        double parsed = strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0') {
+            return false;
+        }
+        result = parsed;
+        return true;
+    }
+
+    static bool parseValue(const string& value, string& result) {
+        result = value;
+        return true;
+    }
+
+    static bool inRange(bool, const ConfigKeyInfo&) { return true; }
+    static bool inRange(const string&, const ConfigKeyInfo&) { return true; }
+    static bool inRange(int value, const ConfigKeyInfo& info) {
+        return value >= info.minValue && value <= info.maxValue;
+    }
+    static bool inRange(double value, const ConfigKeyInfo& info) {
+        return value >= info.minValue && value <= info.maxValue;
+    }
+
+    static string formatValue(bool value) { return value ? "true" : "false"; }
+    static string formatValue(int value) { return to_string(value); }
+    static string formatValue(const string& value) { return value; }
+    static string formatValue(double value) {
+        ostringstream stream;
+        stream << value;
+        string text = stream.str();
+        return text.find('.') == string::npos ? text + ".0" : text;
+    }
+
+    // Parse one key into its field; a bad value keeps the previous one and is reported
+    template<typename T>
+    static void parseSetting(const map<string, string>& raw, ConfigKey key,
+                             T& value, const T& previous, vector<string>& errors) {
+        const ConfigKeyInfo& info = configKeyInfo(key);
+        auto it = raw.find(info.name);
+        if (it == raw.end()) {
+            return;
+        }
+        T parsed = value;
+        if (!parseValue(it->second, parsed)) {
+            errors.push_back(string(info.name) + ": invalid value '" + it->second + "'");
+            value = previous;
+        } else if (!inRange(parsed, info)) {
+            ostringstream message;
+            message << info.name << ": " << it->second << " out of range ["
+                    << info.minValue << ", " << info.maxValue << "]";
+            errors.push_back(message.str());
+            value = previous;
+        } else {
+            value = parsed;
+        }
+    }
+
+    // Build typed settings from the file contents, collecting every problem
+    static Settings parseSettings(const map<string, string>& raw, const Settings& previous,
+                                  vector<string>& errors, vector<string>& warnings) {
+        Settings values;
+#define CONFIG_PARSE(key, type, field, def, lo, hi) \
+        parseSetting(raw, ConfigKey::key, values.field, previous.field, errors);
+        CONFIG_SCHEMA(CONFIG_PARSE)
+#undef CONFIG_PARSE
+
+        // Ranges that depend on each other
+        if (values.lowerBound >= values.upperBound) {
+            errors.push_back("LOWERBOUND must be below UPPERBOUND");
+            values.lowerBound = previous.lowerBound;
+            values.upperBound = previous.upperBound;
+        }
+        if (values.minContourArea >= values.maxContourArea) {
+            errors.push_back("MIN_CONTOUR_AREA must be below MAX_CONTOUR_AREA");
+            values.minContourArea = previous.minContourArea;
+            values.maxContourArea = previous.maxContourArea;
+        }
+
+        // Keys that nothing reads are most likely typos
+        for (const auto& setting : raw) {
+            bool known = false;
+            for (const ConfigKeyInfo& info : CONFIG_KEYS) {
+                if (setting.first == info.name) {
+                    known = true;
+                    break;
+                }
+            }
+            if (!known) {
+                warnings.push_back(setting.first + ": unknown key, ignored");
+            }
+        }
+        return values;
+    }
+
+    static map<string, string> defaultSettings() {
+        Settings defaults;
+        map<string, string> raw;
+#define CONFIG_DEFAULT(key, type, field, def, lo, hi) \
+        raw[#key] = formatValue(defaults.field);
+        CONFIG_SCHEMA(CONFIG_DEFAULT)
+#undef CONFIG_DEFAULT
+        return raw;
+    }
+
+    // Publish a new snapshot, returns false if it is identical to the current one
+    bool publish(map<string, string> raw, const Settings& values) {
+        lock_guard<mutex> lock(snapshotMutex);
+        const ConfigSnapshot* previous = current.load(memory_order_acquire);
+        if (previous && previous->raw == raw) {
+            return false;
+        }
+        ConfigSnapshot* snapshot = new ConfigSnapshot();
+        snapshot->raw = std::move(raw);
+        snapshot->values = values;
+        snapshots.emplace_back(snapshot);
+        current.store(snapshot, memory_order_release);
+        if (snapshots.size() > KEPT_SNAPSHOTS) {
+            snapshots.erase(snapshots.begin());
+        }
+        return true;
+    }
+
+    const ConfigSnapshot& snapshot() const {
+        return *current.load(memory_order_acquire);
+    }
 
 public:
 //    Config(const string& filePath = "/home/kng/Drip/config.ini") : configFilePath(filePath) {
-    Config(const string& filePath = "./config.ini") : configFilePath(filePath) {
-        loadConfig();
+    // createIfMissing false leaves a missing file alone and runs on the defaults
+    Config(const string& filePath = "./config.ini", bool createIfMissing = true)
+        : configFilePath(filePath), current(nullptr), changePending(false) {
+        publish(map<string, string>(), Settings());
+        if (ifstream(configFilePath).is_open()) {
+            loadConfig();
+        } else if (createIfMissing) {
+            // If file doesn't exist, create a default config
+            createDefaultConfig();
+        }
     }
 
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+
+    const string& getFilePath() const {
+        return configFilePath;
+    }
+
+    // Parse the file and publish it; invalid values keep their previous value and are
+    // reported. A missing file (an editor replacing it) keeps the current settings.
+    // Subscribers are told on the next dispatchChanges()
     bool loadConfig() {
-        settings.clear();
         ifstream configFile(configFilePath);
 
         if (!configFile.is_open()) {
-            // If file doesn't exist, create a default config
-            createDefaultConfig();
+            cerr << "Warning: Config " << configFilePath << " not found, keeping current settings" << endl;
             return false;
         }
 
+        map<string, string> settings;
         string line;
         while (getline(configFile, line)) {
             // Skip comments and empty lines
@@ -46,15 +240,29 @@ public:
                 // Trim whitespace
                 key.erase(0, key.find_first_not_of(" \t"));
                 key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
+                value.erase(0, value.find_first_not_of(" \t\r"));
+                value.erase(value.find_last_not_of(" \t\r") + 1);
 
                 settings[key] = value;
             }
         }
 
         configFile.close();
-        return true;
+
+        vector<string> errors;
+        vector<string> warnings;
+        Settings values = parseSettings(settings, snapshot().values, errors, warnings);
+        for (const string& error : errors) {
+            cerr << "Error: Config " << configFilePath << ": " << error << endl;
+        }
+        for (const string& warning : warnings) {
+            cerr << "Warning: Config " << configFilePath << ": " << warning << endl;
+        }
+
+        if (publish(std::move(settings), values)) {
+            changePending.store(true);
+        }
+        return errors.empty();
     }
 
     bool saveConfig() {
@@ -67,7 +275,7 @@ public:
         configFile << "# Water Dripping Investigation Recording Tools Configuration\n";
         configFile << "# Automatically generated - you can edit this file\n\n";
 
-        for (const auto& setting : settings) {
+        for (const auto& setting : snapshot().raw) {
             configFile << setting.first << " = " << setting.second << "\n";
         }
 
@@ -77,23 +285,9 @@ public:
 
     void createDefaultConfig() {
         // Set default values
-        settings["DISPLAY_WIDTH"] = "1280";
-        settings["DISPLAY_HEIGHT"] = "800";
-        settings["CAMERA_WIDTH"] = "1280";
-        settings["CAMERA_HEIGHT"] = "720";
-        settings["EXPORT_DEST_DIR"] = "./recordings/";
-        settings["KEEP_ORIGINAL_FILES"] = "true";
-        settings["RECORDING_FPS"] = "30.0";
-        settings["SHOW_FPS"] = "false";
-        settings["SHOW_NAV_BAR"] = "true";
-        settings["ZOOM_LEVEL"] = "512";
-        settings["FULL_SCREEN"] = "true";
-        settings["UPPERBOUND"] = "200";
-        settings["LOWERBOUND"] = "0";
-        settings["MIN_CONTOUR_AREA"] = "0";
-        settings["MAX_CONTOUR_AREA"] = "300";
-        settings["SHOW_BG_SUB_CONTROLS"] = "true";
-        settings["CONSECUTIVE_FRAMES"] = "3";
+        if (publish(defaultSettings(), Settings())) {
+            changePending.store(true);
+        }
 
         // Save the default configuration
         saveConfig();
@@ -101,55 +295,26 @@ public:
         cout << "Created default configuration file at: " << configFilePath << endl;
     }
 
-    // Get value as string
-    string getString(const string& key, const string& defaultValue = "") const {
-        auto it = settings.find(key);
-        if (it != settings.end()) {
-            return it->second;
-        }
-        return defaultValue;
+    // Register a callback run (on the main loop) whenever new settings are published
+    void subscribe(function<void(const Config&)> callback) {
+        lock_guard<mutex> lock(subscriberMutex);
+        subscribers.push_back(std::move(callback));
     }
 
-    // Get value as int
-    int getInt(const string& key, int defaultValue = 0) const {
-        auto it = settings.find(key);
-        if (it != settings.end()) {
-            try {
-                return stoi(it->second);
-            } catch (...) {
-                return defaultValue;
-            }
+    // Notify subscribers if the settings changed since the last call
+    void dispatchChanges() {
+        if (!changePending.exchange(false)) {
+            return;
         }
-        return defaultValue;
-    }
-
-    // Get value as double
-    double getDouble(const string& key, double defaultValue = 0.0) const {
-        auto it = settings.find(key);
-        if (it != settings.end()) {
-            try {
-                return stod(it->second);
-            } catch (...) {
-                return defaultValue;
-            }
+        lock_guard<mutex> lock(subscriberMutex);
+        for (const auto& callback : subscribers) {
+            callback(*this);
         }
-        return defaultValue;
     }
 
-    // Get value as bool
-    bool getBool(const string& key, bool defaultValue = false) const {
-        auto it = settings.find(key);
-        if (it != settings.end()) {
-            string value = it->second;
-            // Convert to lowercase for case-insensitive comparison
-            transform(value.begin(), value.end(), value.begin(), ::tolower);
-            if (value == "true" || value == "yes" || value == "1") {
-                return true;
-            } else if (value == "false" || value == "no" || value == "0") {
-                return false;
-            }
-        }
-        return defaultValue;
+    // Typed settings of the current snapshot (a single pointer load)
+    const Settings& settings() const {
+        return snapshot().values;
     }
 };
 
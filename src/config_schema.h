@@ -0,0 +1,90 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Every setting the application reads, in one place:
+//   X(KEY, type, field, default, min, max)
+// KEY is the name used in config.ini and field the member of Settings.
+// min/max are only checked for int and double settings.
+#define CONFIG_SCHEMA(X) \
+    X(ADAPTIVE_PREVIEW,     bool,   adaptivePreview,   true,            0,   1)      \
+    X(ALLOC_STATS,          bool,   allocStats,        false,           0,   1)      \
+    X(CAMERA_HEIGHT,        int,    cameraHeight,      720,             120, 4320)   \
+    X(CAMERA_WIDTH,         int,    cameraWidth,       1280,            160, 7680)   \
+    X(CONTINUOUS_ZOOM,      bool,   continuousZoom,    false,           0,   1)      \
+    X(DISPLAY_HEIGHT,       int,    displayHeight,     800,             240, 4320)   \
+    X(DISPLAY_WIDTH,        int,    displayWidth,      1280,            320, 7680)   \
+    X(EXPORT_DEST_DIR,      string, exportDestDir,     "./recordings/", 0,   0)      \
+    X(FRAME_SOURCE,         string, frameSource,       "",              0,   0)      \
+    X(FULL_SCREEN,          bool,   fullScreen,        true,            0,   1)      \
+    X(KEEP_ORIGINAL_FILES,  bool,   keepOriginalFiles, true,            0,   1)      \
+    X(LOWERBOUND,           int,    lowerBound,        0,               0,   100000) \
+    X(MAT_POOL,             bool,   matPool,           true,            0,   1)      \
+    X(MAX_CONTOUR_AREA,     int,    maxContourArea,    300,             1,   100000) \
+    X(METRICS_PORT,         int,    metricsPort,       0,               0,   65535)  \
+    X(MIN_CONTOUR_AREA,     int,    minContourArea,    0,               0,   100000) \
+    X(RECORDING_FPS,        double, recordingFps,      30.0,            1,   120)    \
+    X(SERIAL_PORT,          string, serialPort,        "",              0,   0)      \
+    X(SERIAL_USB_ID,        string, serialUsbId,       "",              0,   0)      \
+    X(SHOW_BG_SUB_CONTROLS, bool,   showBgSubControls, true,            0,   1)      \
+    X(SHOW_FPS,             bool,   showFps,           false,           0,   1)      \
+    X(SHOW_LATENCY,         bool,   showLatency,       false,           0,   1)      \
+    X(SHOW_NAV_BAR,         bool,   showNavBar,        true,            0,   1)      \
+    X(TRACE,                bool,   trace,             false,           0,   1)      \
+    X(UPPERBOUND,           int,    upperBound,        200,             0,   100000) \
+    X(ZOOM_LEVEL,           int,    zoomStep,          512,             1,   16384)  \
+    X(ZOOM_SPEED,           int,    zoomSpeed,         4,               0,   7)
+
+// Compile-time key IDs
+enum class ConfigKey : int {
+#define CONFIG_KEY_ID(key, type, field, def, lo, hi) key,
+    CONFIG_SCHEMA(CONFIG_KEY_ID)
+#undef CONFIG_KEY_ID
+    COUNT
+};
+
+enum class ConfigType { Bool, Int, Double, String };
+
+template<typename T> struct ConfigTypeOf;
+template<> struct ConfigTypeOf<bool> { static constexpr ConfigType value = ConfigType::Bool; };
+template<> struct ConfigTypeOf<int> { static constexpr ConfigType value = ConfigType::Int; };
+template<> struct ConfigTypeOf<double> { static constexpr ConfigType value = ConfigType::Double; };
+template<> struct ConfigTypeOf<string> { static constexpr ConfigType value = ConfigType::String; };
+
+// Name, type and valid range of a key
+struct ConfigKeyInfo {
+    const char* name;
+    ConfigType type;
+    double minValue;
+    double maxValue;
+};
+
+constexpr ConfigKeyInfo CONFIG_KEYS[] = {
+#define CONFIG_KEY_INFO(key, type, field, def, lo, hi) {#key, ConfigTypeOf<type>::value, lo, hi},
+    CONFIG_SCHEMA(CONFIG_KEY_INFO)
+#undef CONFIG_KEY_INFO
+};
+
+static_assert(sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]) == size_t(ConfigKey::COUNT),
+              "Config schema table out of sync with ConfigKey");
+
+constexpr const ConfigKeyInfo& configKeyInfo(ConfigKey key) {
+    return CONFIG_KEYS[int(key)];
+}
+
+constexpr const char* configKeyName(ConfigKey key) {
+    return CONFIG_KEYS[int(key)].name;
+}
+
+// Typed settings, one field per schema entry, initialized to the schema default
+struct Settings {
+#define CONFIG_FIELD(key, type, field, def, lo, hi) type field = def;
+    CONFIG_SCHEMA(CONFIG_FIELD)
+#undef CONFIG_FIELD
+};
+
+#endif // CONFIG_SCHEMA_H
@@ -0,0 +1,84 @@
+#include "config_watcher.h"
+#include <sys/inotify.h>
+#include <poll.h>
+
+// Editors often write a file in several steps; wait for them to settle
+static const int RELOAD_SETTLE_MS = 200;
+
+// How often the thread checks for a stop request
+static const int POLL_INTERVAL_MS = 500;
+
+static thread watcherThread;
+static atomic<bool> watcherRunning(false);
+static int inotifyFd = -1;
+
+static void watchConfigFile(string configName) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool reloadPending = false;
+    steady_clock::time_point lastChange;
+
+    while (watcherRunning) {
+        struct pollfd pfd = {inotifyFd, POLLIN, 0};
+        int timeout = reloadPending ? RELOAD_SETTLE_MS : POLL_INTERVAL_MS;
+        int ready = poll(&pfd, 1, timeout);
+
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            ssize_t len = read(inotifyFd, buffer, sizeof(buffer));
+            for (char* ptr = buffer; len > 0 && ptr < buffer + len; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                // The directory is watched, so also catch editors that replace the file
+                if (event->len > 0 && configName == event->name) {
+                    reloadPending = true;
+                    lastChange = steady_clock::now();
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+
+        if (reloadPending &&
+            steady_clock::now() - lastChange >= milliseconds(RELOAD_SETTLE_MS)) {
+            reloadPending = false;
+            if (appConfig.loadConfig()) {
+                cout << "Configuration reloaded" << endl;
+            }
+        }
+    }
+}
+
+bool startConfigWatcher() {
+    if (watcherRunning) {
+        return true;
+    }
+
+    filesystem::path configPath(appConfig.getFilePath());
+    string directory = configPath.has_parent_path() ? configPath.parent_path().string() : ".";
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        cerr << "Failed to initialize inotify, config hot reload disabled" << endl;
+        return false;
+    }
+
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        cerr << "Failed to watch " << directory << ", config hot reload disabled" << endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    watcherRunning = true;
+    watcherThread = thread(watchConfigFile, configPath.filename().string());
+    return true;
+}
+
+void stopConfigWatcher() {
+    if (!watcherRunning) {
+        return;
+    }
+    watcherRunning = false;
+    if (watcherThread.joinable()) {
+        watcherThread.join();
+    }
+    close(inotifyFd);
+    inotifyFd = -1;
+}
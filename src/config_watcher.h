@@ -0,0 +1,12 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include "common.h"
+
+// Watch the config file (inotify) and reload appConfig when it changes
+bool startConfigWatcher();
+
+// Stop the watcher thread
+void stopConfigWatcher();
+
+#endif // CONFIG_WATCHER_H
@@ -0,0 +1,15 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), as used by iSCSI, ext4 and Btrfs.
+// Uses the SSE4.2 / ARMv8 CRC instructions when the CPU has them.
+// Pass the previous result to continue a checksum over several buffers.
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+// True if the hardware implementation is in use
+bool crc32cHardware();
+
+#endif // CRC32C_H
@@ -0,0 +1,130 @@
+#include "digital_zoom.h"
+
+const double MIN_DIGITAL_ZOOM = 1.0;
+const double MAX_DIGITAL_ZOOM = 8.0;
+
+// Zoom factor applied by each zoom step
+static const double DIGITAL_ZOOM_STEP = 1.25;
+
+// Fraction of the visible area moved by one pan step
+static const double PAN_STEP_FRACTION = 0.25;
+
+// View state: zoom factor and view center in normalized frame coordinates
+static double digitalZoom = 1.0;
+static double viewCenterX = 0.5;
+static double viewCenterY = 0.5;
+
+// Frame size used for mapping, falls back to the configured size before the first frame
+static Size currentFrameSize() {
+    if (frameSize.width > 0 && frameSize.height > 0) {
+        return frameSize;
+    }
+    return Size(WIDTH, HEIGHT);
+}
+
+// Keep the view inside the frame
+static void clampViewCenter() {
+    double half = 0.5 / digitalZoom;
+    viewCenterX = max(half, min(1.0 - half, viewCenterX));
+    viewCenterY = max(half, min(1.0 - half, viewCenterY));
+}
+
+static void updateZoomLog() {
+    if (isDigitalZoomActive()) {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(1) << digitalZoom;
+        setLogMessage("Digital zoom: " + stream.str() + "x");
+    } else {
+        setLogMessage("Digital zoom off");
+    }
+}
+
+double getDigitalZoom() {
+    return digitalZoom;
+}
+
+bool isDigitalZoomActive() {
+    return digitalZoom > MIN_DIGITAL_ZOOM;
+}
+
+Rect getViewRect(Size cameraFrameSize) {
+    if (!isDigitalZoomActive()) {
+        return Rect(0, 0, cameraFrameSize.width, cameraFrameSize.height);
+    }
+
+    int viewWidth = max(1, cvRound(cameraFrameSize.width / digitalZoom));
+    int viewHeight = max(1, cvRound(cameraFrameSize.height / digitalZoom));
+    int viewX = cvRound(viewCenterX * cameraFrameSize.width - viewWidth / 2.0);
+    int viewY = cvRound(viewCenterY * cameraFrameSize.height - viewHeight / 2.0);
+
+    viewX = max(0, min(cameraFrameSize.width - viewWidth, viewX));
+    viewY = max(0, min(cameraFrameSize.height - viewHeight, viewY));
+    return Rect(viewX, viewY, viewWidth, viewHeight);
+}
+
+Point displayToFrame(Point displayPoint, Size displaySize) {
+    Rect view = getViewRect(currentFrameSize());
+    if (displaySize.width <= 0 || displaySize.height <= 0) {
+        return Point(view.x, view.y);
+    }
+    return Point(view.x + displayPoint.x * view.width / displaySize.width,
+                 view.y + displayPoint.y * view.height / displaySize.height);
+}
+
+void digitalZoomAt(double factor, Point displayPoint, Size displaySize) {
+    double newZoom = max(MIN_DIGITAL_ZOOM, min(MAX_DIGITAL_ZOOM, digitalZoom * factor));
+    if (newZoom == digitalZoom) {
+        return;
+    }
+
+    Size size = currentFrameSize();
+    Point anchor = displayToFrame(displayPoint, displaySize);
+
+    // Place the new view so that the anchor stays under the same display point
+    double fx = displaySize.width > 0 ? double(displayPoint.x) / displaySize.width : 0.5;
+    double fy = displaySize.height > 0 ? double(displayPoint.y) / displaySize.height : 0.5;
+    double newViewWidth = size.width / newZoom;
+    double newViewHeight = size.height / newZoom;
+
+    digitalZoom = newZoom;
+    viewCenterX = (anchor.x - fx * newViewWidth + newViewWidth / 2.0) / size.width;
+    viewCenterY = (anchor.y - fy * newViewHeight + newViewHeight / 2.0) / size.height;
+    clampViewCenter();
+    updateZoomLog();
+}
+
+void digitalZoomIn() {
+    digitalZoom = min(MAX_DIGITAL_ZOOM, digitalZoom * DIGITAL_ZOOM_STEP);
+    clampViewCenter();
+    updateZoomLog();
+}
+
+void digitalZoomOut() {
+    digitalZoom = max(MIN_DIGITAL_ZOOM, digitalZoom / DIGITAL_ZOOM_STEP);
+    clampViewCenter();
+    updateZoomLog();
+}
+
+void resetDigitalZoom() {
+    digitalZoom = MIN_DIGITAL_ZOOM;
+    viewCenterX = 0.5;
+    viewCenterY = 0.5;
+    updateZoomLog();
+}
+
+void panView(int stepsX, int stepsY) {
+    if (!isDigitalZoomActive()) {
+        setLogMessage("Zoom in to pan");
+        return;
+    }
+    viewCenterX += stepsX * PAN_STEP_FRACTION / digitalZoom;
+    viewCenterY += stepsY * PAN_STEP_FRACTION / digitalZoom;
+    clampViewCenter();
+}
+
+void renderPreview(const Mat& frame, Mat& uiFrame, Size displaySize) {
+    // frame(view) is a header on the same pixels, so the only per-frame
+    // work is the same single resize as the unzoomed preview
+    Rect view = getViewRect(frame.size()) & Rect(0, 0, frame.cols, frame.rows);
+    resize(frame(view), uiFrame, displaySize);
+}
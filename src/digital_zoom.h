@@ -0,0 +1,38 @@
+#ifndef DIGITAL_ZOOM_H
+#define DIGITAL_ZOOM_H
+
+#include "common.h"
+
+// Digital zoom limits (1.0 = whole camera frame)
+extern const double MIN_DIGITAL_ZOOM;
+extern const double MAX_DIGITAL_ZOOM;
+
+// Current digital zoom factor
+double getDigitalZoom();
+
+// True when the preview shows only part of the camera frame
+bool isDigitalZoomActive();
+
+// Zoom the preview in/out around a display point (keeps that point under the cursor)
+void digitalZoomAt(double factor, Point displayPoint, Size displaySize);
+
+// Zoom the preview in/out around its current center
+void digitalZoomIn();
+void digitalZoomOut();
+
+// Go back to the full frame
+void resetDigitalZoom();
+
+// Move the visible area by a fraction of its own size (e.g. 0, -1 = one step up)
+void panView(int stepsX, int stepsY);
+
+// Region of the camera frame currently shown in the preview
+Rect getViewRect(Size cameraFrameSize);
+
+// Map a point on the display to camera frame coordinates
+Point displayToFrame(Point displayPoint, Size displaySize);
+
+// Resize the visible region of the frame into the display buffer (ROI view, no copy)
+void renderPreview(const Mat& frame, Mat& uiFrame, Size displaySize);
+
+#endif // DIGITAL_ZOOM_H
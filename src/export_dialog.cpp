@@ -1,10 +1,28 @@
 #include "export_dialog.h"
-#include <dirent.h>
+#include "frame_pacing.h"
+#include "export_job.h"
+#include "recordings_catalog.h"
+#include "thumbnail_job.h"
 #include <sys/stat.h>
 #include <fstream>
 
 MouseCallbackData mouseData;
 
+// Catalog metadata line and preview strip file for each entry of recordingFiles
+static vector<string> recordingDetails;
+static vector<string> recordingThumbnails;
+
+// Preview strips loaded so far, only rows that have been on screen are read
+static map<string, Mat> thumbnailCache;
+
+static const Mat& loadThumbnail(const string& path) {
+    auto it = thumbnailCache.find(path);
+    if (it == thumbnailCache.end()) {
+        it = thumbnailCache.emplace(path, path.empty() ? Mat() : imread(path)).first;
+    }
+    return it->second;
+}
+
 string openDirectoryBrowser() {
     // If a dialog is already active, don't open another one
     if (directoryDialogActive.load()) {
@@ -130,25 +148,16 @@ void createExportDialog(int windowWidth, int windowHeight) {
 void scanRecordingDirectory() {
     recordingFiles.clear();
     fileSelection.clear();
-
-    DIR *dir;
-    struct dirent *ent;
-
-    if ((dir = opendir("./recordings")) != NULL) {
-        while ((ent = readdir(dir)) != NULL) {
-            string filename = ent->d_name;
-            // Skip . and .. directories and other non-video files
-            if (filename != "." && filename != ".." &&
-                (filename.find(".mp4") != string::npos ||
-                 filename.find(".avi") != string::npos)) {
-                recordingFiles.push_back(filename);
-                fileSelection.push_back(false); // Initially not selected
-            }
-        }
-        closedir(dir);
-
-        // Sort recordings alphabetically
-        sort(recordingFiles.begin(), recordingFiles.end());
+    recordingDetails.clear();
+    recordingThumbnails.clear();
+    thumbnailCache.clear();
+
+    // The catalog is kept current in the background and comes sorted by name
+    for (const RecordingInfo& info : getRecordingsCatalog()) {
+        recordingFiles.push_back(info.name);
+        fileSelection.push_back(false); // Initially not selected
+        recordingDetails.push_back(formatRecordingInfo(info));
+        recordingThumbnails.push_back(info.thumbnail.empty() ? "" : RECORDINGS_DIR + info.thumbnail);
     }
 
     // Reset scroll position
@@ -160,10 +169,12 @@ void drawExportDialog(Mat& img) {
     int dialogHeight = DISPLAY_HEIGHT * 0.8;
     if (!showExportDialog) return;
 
-    // Draw semi-transparent overlay for the entire screen
-    Mat overlay = img.clone();
-    rectangle(overlay, Rect(0, 0, img.cols, img.rows), Scalar(30, 30, 30), -1);
-    addWeighted(overlay, 0.7, img, 0.3, 0, img);
+    // Draw semi-transparent overlay for the entire screen (skipped under load)
+    if (!isOverlayReduced()) {
+        Mat overlay = img.clone();
+        rectangle(overlay, Rect(0, 0, img.cols, img.rows), Scalar(30, 30, 30), -1);
+        addWeighted(overlay, 0.7, img, 0.3, 0, img);
+    }
 
     // Draw dialog box
     rectangle(img, exportDialogRect, THEME_COLOR, -1);
@@ -227,13 +238,34 @@ void drawExportDialog(Mat& img) {
                  TEXT_COLOR, 2);
         }
 
+        // Metadata right-aligned on the row, the name gets the space left of it
+        int nameMaxChars = maxChars;
+        if (i < recordingDetails.size()) {
+            int baseline = 0;
+            Size detailsSize = getTextSize(recordingDetails[i], FONT_HERSHEY_SIMPLEX, 0.4, 1, &baseline);
+            int detailsX = fileListRect.x + fileListRect.width - detailsSize.width - 10;
+            putText(img, recordingDetails[i], Point(detailsX, y + 5),
+                    FONT_HERSHEY_SIMPLEX, 0.4, Scalar(160, 160, 160), 1);
+
+            // Preview strip to the left of the metadata
+            const Mat& thumbnail = loadThumbnail(recordingThumbnails[i]);
+            Rect stripRect(detailsX - thumbnail.cols - 10, y - thumbnail.rows / 2,
+                           thumbnail.cols, thumbnail.rows);
+            if (!thumbnail.empty() && stripRect.x > checkboxRect.x + 200 &&
+                stripRect.height < 30 && (stripRect & Rect(0, 0, img.cols, img.rows)) == stripRect) {
+                thumbnail.copyTo(img(stripRect));
+                detailsX = stripRect.x;
+            }
+            nameMaxChars = max(4, int((detailsX - checkboxRect.x - checkboxSize - checkboxPadding - 10) / charWidth));
+        }
+
         // Get the filename and truncate if too long
         string filename = recordingFiles[i];
         string displayName = filename;
 
-        if (filename.length() > maxChars) {
+        if (filename.length() > nameMaxChars) {
             // Keep first part and append '...'
-            displayName = filename.substr(0, maxChars - 3) + "...";
+            displayName = filename.substr(0, nameMaxChars - 3) + "...";
         }
 
         // Draw truncated filename
@@ -373,84 +405,13 @@ void drawExportDialog(Mat& img) {
 }
 
 void performExport() {
-    // Make sure destination directory exists
-    mkdir(exportDestDir.c_str(), 0777);
-
-    int exportCount = 0;
+    vector<string> selectedFiles;
     for (size_t i = 0; i < recordingFiles.size(); i++) {
         if (fileSelection[i]) {
-            string srcPath = "./recordings/" + recordingFiles[i];
-            string destPath = exportDestDir + recordingFiles[i];
-
-            // Copy file to destination using better file handling
-            bool copySuccess = false;
-
-            // Open source file in binary mode
-            std::ifstream src(srcPath, std::ios::binary);
-            if (src) {
-                // Open destination file in binary mode
-                std::ofstream dst(destPath, std::ios::binary);
-                if (dst) {
-                    // Get source file size
-                    src.seekg(0, std::ios::end);
-                    std::streamsize size = src.tellg();
-                    src.seekg(0, std::ios::beg);
-
-                    // Allocate buffer
-                    const int bufferSize = 4096;
-                    char buffer[bufferSize];
-
-                    // Copy file in chunks
-                    while (size > 0) {
-                        std::streamsize bytesToRead = std::min(static_cast<std::streamsize>(bufferSize), size);
-                        src.read(buffer, bytesToRead);
-                        dst.write(buffer, src.gcount());
-                        size -= src.gcount();
-                    }
-
-                    dst.close();
-                    copySuccess = true;
-                }
-                src.close();
-            }
-
-            // Check file sizes to confirm copy worked
-            struct stat srcStat, dstStat;
-            bool sizeCheckOk = false;
-
-            if (stat(srcPath.c_str(), &srcStat) == 0 &&
-                stat(destPath.c_str(), &dstStat) == 0) {
-                sizeCheckOk = (srcStat.st_size == dstStat.st_size && srcStat.st_size > 0);
-            }
-
-            if (copySuccess && sizeCheckOk) {
-                exportCount++;
-
-                // Delete original file if not keeping them
-                if (!keepOriginalFiles) {
-                    if (remove(srcPath.c_str()) == 0) {
-                        cout << "Deleted original file: " << srcPath << endl;
-                    } else {
-                        cerr << "Failed to delete original file: " << srcPath << endl;
-                    }
-                }
-            } else {
-                cerr << "Failed to copy file: " << srcPath << " to " << destPath << endl;
-                if (copySuccess && !sizeCheckOk) {
-                    cerr << "File size mismatch after copy!" << endl;
-                }
-            }
+            selectedFiles.push_back(recordingFiles[i]);
         }
     }
 
-    if (exportCount > 0) {
-        setLogMessage("Exported " + to_string(exportCount) + " files");
-
-        // Refresh the file list (some might have been deleted)
-        if (!keepOriginalFiles) {
-            scanRecordingDirectory();
-        }
-    } else {
-        setLogMessage("No files selected for export");
-    }
+    // Copying runs in the background, the preview keeps going
+    startExportJob(selectedFiles, "./recordings/", exportDestDir, keepOriginalFiles);
 }
@@ -18,7 +18,7 @@ string openDirectoryBrowser();
 // Check if directory selection has completed
 void checkDirectorySelection();
 
-// Perform export operation
+// Start exporting the selected files (see export_job.h)
 void performExport();
 
 // MouseCallbackData structure for handling export UI interaction
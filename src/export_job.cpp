@@ -0,0 +1,470 @@
+#include "export_job.h"
+#include "export_dialog.h"
+#include "crc32c.h"
+#include "trace.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+// Files copied at the same time; enough to keep a USB stick busy
+static const size_t EXPORT_WORKERS = 3;
+
+// Bytes per copy_file_range/sendfile call, also the progress granularity
+static const size_t COPY_CHUNK = 8 * 1024 * 1024;
+
+// Fallback buffer for file systems without in-kernel copies
+static const size_t COPY_BUFFER_SIZE = 1024 * 1024;
+static const size_t COPY_BUFFER_ALIGN = 4096;
+
+// Written to the export directory: one "crc32c size name" line per verified file
+static const char* MANIFEST_NAME = "drip_export_manifest.txt";
+
+struct ExportFile {
+    string name;
+    string sourcePath;
+    string destPath;
+    off_t size;
+    bool moved;         // renamed instead of copied
+    bool resumed;       // already exported and verified by an earlier run
+    uint32_t checksum;
+    bool ok;
+};
+
+struct ManifestEntry {
+    uint32_t checksum;
+    off_t size;
+};
+
+static thread exportThread;
+static atomic<bool> exportRunning(false);
+static atomic<bool> exportFinished(false);
+static atomic<bool> exportCancelled(false);
+static atomic<size_t> nextExportFile(0);
+static atomic<uint64_t> exportedBytes(0);
+static uint64_t exportTotalBytes = 0;
+static vector<ExportFile> exportFiles;
+static bool exportKeepOriginals = true;
+static string exportManifestPath;
+static mutex manifestMutex;
+
+static void updateExportProgress() {
+    if (exportTotalBytes == 0) {
+        return;
+    }
+    int percent = int(exportedBytes.load() * 100 / exportTotalBytes);
+    progressValue = min(percent, 99);
+}
+
+// Copy with plain read/write through an aligned buffer
+static bool copyBuffered(int src, int dst, off_t size) {
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, COPY_BUFFER_ALIGN, COPY_BUFFER_SIZE) != 0) {
+        return false;
+    }
+    bool ok = true;
+    off_t done = 0;
+    while (done < size && !exportCancelled) {
+        ssize_t count = read(src, buffer, COPY_BUFFER_SIZE);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            ok = false;
+            break;
+        }
+        for (ssize_t written = 0; written < count; ) {
+            ssize_t result = write(dst, static_cast<char*>(buffer) + written, count - written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                ok = false;
+                break;
+            }
+            written += result;
+        }
+        if (!ok) {
+            break;
+        }
+        done += count;
+        exportedBytes += count;
+        updateExportProgress();
+    }
+    free(buffer);
+    return ok && done == size;
+}
+
+// Copy inside the kernel: copy_file_range (may reflink or copy server-side),
+// then sendfile, then the buffered loop when neither is supported
+static bool copyFileData(int src, int dst, off_t size) {
+    off_t done = 0;
+    bool useCopyRange = true;
+
+    while (done < size && !exportCancelled) {
+        size_t chunk = min<off_t>(COPY_CHUNK, size - done);
+        ssize_t count;
+        if (useCopyRange) {
+            count = copy_file_range(src, nullptr, dst, nullptr, chunk, 0);
+            if (count < 0 && done == 0 &&
+                (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useCopyRange = false;
+                continue;
+            }
+        } else {
+            count = sendfile(dst, src, nullptr, chunk);
+            if (count < 0 && done == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                return copyBuffered(src, dst, size);
+            }
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            cerr << "Copy failed: " << strerror(errno) << endl;
+            return false;
+        }
+        done += count;
+        exportedBytes += count;
+        updateExportProgress();
+    }
+    return done == size;
+}
+
+// CRC-32C of a whole file, read through its own descriptor
+static bool checksumFile(const string& path, uint32_t& checksum, bool fromDevice) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (fromDevice) {
+        // Drop cached pages so the data is read back from the medium itself
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, COPY_BUFFER_ALIGN, COPY_BUFFER_SIZE) != 0) {
+        close(fd);
+        return false;
+    }
+    bool ok = true;
+    uint32_t crc = 0;
+    while (!exportCancelled) {
+        ssize_t count = read(fd, buffer, COPY_BUFFER_SIZE);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            ok = false;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+        crc = crc32c(crc, buffer, count);
+    }
+    free(buffer);
+    close(fd);
+    checksum = crc;
+    return ok && !exportCancelled;
+}
+
+static map<string, ManifestEntry> loadManifest(const string& path) {
+    map<string, ManifestEntry> entries;
+    ifstream manifest(path);
+    string line;
+    while (getline(manifest, line)) {
+        istringstream fields(line);
+        string checksum;
+        long long size;
+        string name;
+        if (fields >> checksum >> size && getline(fields >> ws, name) && !name.empty()) {
+            entries[name] = ManifestEntry{uint32_t(strtoul(checksum.c_str(), nullptr, 16)), off_t(size)};
+        }
+    }
+    return entries;
+}
+
+static void appendManifest(const ExportFile& file) {
+    lock_guard<mutex> lock(manifestMutex);
+    int fd = open(exportManifestPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        cerr << "Failed to write export manifest: " << strerror(errno) << endl;
+        return;
+    }
+    char line[64];
+    int prefix = snprintf(line, sizeof(line), "%08x %lld ", file.checksum, (long long)file.size);
+    string entry = string(line, prefix) + file.name + "\n";
+    if (write(fd, entry.data(), entry.size()) != ssize_t(entry.size()) || fsync(fd) != 0) {
+        cerr << "Failed to write export manifest: " << strerror(errno) << endl;
+    }
+    close(fd);
+}
+
+// Make a rename durable
+static void syncDirectory(const string& path) {
+    int fd = open(filesystem::path(path).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static bool copyFile(ExportFile& file) {
+    TRACE_SCOPE("export copy");
+    int src = open(file.sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+        cerr << "Failed to open " << file.sourcePath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    posix_fadvise(src, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Write under a temporary name, so a partial copy never looks like a recording
+    string partPath = file.destPath + ".part";
+    int dst = open(partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (dst < 0) {
+        cerr << "Failed to create " << partPath << ": " << strerror(errno) << endl;
+        close(src);
+        return false;
+    }
+
+    // The data never passes through user space during the copy, so the source
+    // checksum is computed by a second reader at the same time
+    uint32_t sourceChecksum = 0;
+    bool sourceChecksumOk = false;
+    thread checksumThread([&file, &sourceChecksum, &sourceChecksumOk] {
+        setTraceThreadName("export checksum");
+        TRACE_SCOPE("checksum source");
+        sourceChecksumOk = checksumFile(file.sourcePath, sourceChecksum, false);
+    });
+
+    bool ok = copyFileData(src, dst, file.size);
+
+    struct stat dstStat;
+    if (ok && (fstat(dst, &dstStat) != 0 || dstStat.st_size != file.size)) {
+        cerr << "File size mismatch after copy: " << file.destPath << endl;
+        ok = false;
+    }
+    // On the medium before it counts as exported
+    if (ok && fsync(dst) != 0) {
+        cerr << "Failed to sync " << partPath << ": " << strerror(errno) << endl;
+        ok = false;
+    }
+    close(src);
+    if (close(dst) != 0) {
+        ok = false;
+    }
+
+    checksumThread.join();
+    if (ok && !sourceChecksumOk) {
+        cerr << "Failed to checksum " << file.sourcePath << endl;
+        ok = false;
+    }
+    file.checksum = sourceChecksum;
+
+    // Read the copy back from the medium; only verified files go in the
+    // manifest, since a resumed export trusts it without checksumming again
+    if (ok) {
+        TRACE_SCOPE("verify copy");
+        uint32_t destChecksum = 0;
+        if (!checksumFile(partPath, destChecksum, true) || destChecksum != sourceChecksum) {
+            cerr << "Checksum mismatch after copy: " << file.destPath << endl;
+            ok = false;
+        }
+    }
+
+    if (ok && rename(partPath.c_str(), file.destPath.c_str()) != 0) {
+        cerr << "Failed to rename " << partPath << ": " << strerror(errno) << endl;
+        ok = false;
+    }
+    if (!ok) {
+        unlink(partPath.c_str());
+        return false;
+    }
+    syncDirectory(file.destPath);
+    appendManifest(file);
+    return true;
+}
+
+// Finish a file an earlier export already copied and verified
+static bool resumeFile(ExportFile& file) {
+    if (!exportKeepOriginals) {
+        uint32_t destChecksum = 0;
+        if (!checksumFile(file.destPath, destChecksum, true) || destChecksum != file.checksum) {
+            cerr << "Exported copy does not match the manifest: " << file.destPath << endl;
+            return copyFile(file);
+        }
+    }
+    exportedBytes += file.size;
+    updateExportProgress();
+    return true;
+}
+
+static void exportWorker() {
+    setTraceThreadName("export");
+    while (!exportCancelled) {
+        size_t index = nextExportFile++;
+        if (index >= exportFiles.size()) {
+            return;
+        }
+        ExportFile& file = exportFiles[index];
+
+        if (file.moved) {
+            // Same file system and originals not kept: a rename is the whole export
+            file.ok = rename(file.sourcePath.c_str(), file.destPath.c_str()) == 0;
+            if (!file.ok) {
+                cerr << "Failed to move " << file.sourcePath << ": " << strerror(errno) << endl;
+                continue;
+            }
+            exportedBytes += file.size;
+            updateExportProgress();
+            continue;
+        }
+
+        file.ok = file.resumed ? resumeFile(file) : copyFile(file);
+        if (!file.ok) {
+            cerr << "Failed to copy file: " << file.sourcePath << " to " << file.destPath << endl;
+        } else if (!exportKeepOriginals) {
+            if (remove(file.sourcePath.c_str()) == 0) {
+                cout << "Deleted original file: " << file.sourcePath << endl;
+            } else {
+                cerr << "Failed to delete original file: " << file.sourcePath << endl;
+            }
+        }
+    }
+}
+
+static void runExport() {
+    vector<thread> workers;
+    size_t workerCount = min(EXPORT_WORKERS, exportFiles.size());
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(exportWorker);
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    exportFinished = true;
+}
+
+bool startExportJob(const vector<string>& files, const string& sourceDir,
+                    const string& destDir, bool keepOriginals) {
+    if (exportRunning) {
+        setLogMessage("Export in progress...");
+        return false;
+    }
+    if (files.empty()) {
+        setLogMessage("No files selected for export");
+        return false;
+    }
+
+    // Make sure destination directory exists
+    error_code error;
+    filesystem::create_directories(destDir, error);
+    if (filesystem::equivalent(sourceDir, destDir, error)) {
+        setLogMessage("Choose another export directory");
+        return false;
+    }
+
+    struct stat sourceDirStat, destDirStat;
+    bool sameFileSystem = stat(sourceDir.c_str(), &sourceDirStat) == 0 &&
+                          stat(destDir.c_str(), &destDirStat) == 0 &&
+                          sourceDirStat.st_dev == destDirStat.st_dev;
+
+    // Files a previous (possibly interrupted) export already verified are skipped
+    exportManifestPath = (filesystem::path(destDir) / MANIFEST_NAME).string();
+    map<string, ManifestEntry> manifest = loadManifest(exportManifestPath);
+
+    exportFiles.clear();
+    exportTotalBytes = 0;
+    int resumedCount = 0;
+    for (const string& name : files) {
+        ExportFile file;
+        file.name = name;
+        file.sourcePath = (filesystem::path(sourceDir) / name).string();
+        file.destPath = (filesystem::path(destDir) / name).string();
+        struct stat sourceStat;
+        if (stat(file.sourcePath.c_str(), &sourceStat) != 0 || sourceStat.st_size == 0) {
+            cerr << "Skipping missing or empty file: " << file.sourcePath << endl;
+            continue;
+        }
+        file.size = sourceStat.st_size;
+        file.moved = sameFileSystem && !keepOriginals;
+        file.resumed = false;
+        file.checksum = 0;
+        file.ok = false;
+
+        auto entry = manifest.find(name);
+        struct stat destStat;
+        if (!file.moved && entry != manifest.end() && entry->second.size == file.size &&
+            stat(file.destPath.c_str(), &destStat) == 0 && destStat.st_size == file.size) {
+            file.resumed = true;
+            file.checksum = entry->second.checksum;
+            resumedCount++;
+        }
+        exportTotalBytes += file.size;
+        exportFiles.push_back(file);
+    }
+    if (exportFiles.empty()) {
+        setLogMessage("No files selected for export");
+        return false;
+    }
+
+    if (exportThread.joinable()) {
+        exportThread.join();
+    }
+    exportKeepOriginals = keepOriginals;
+    nextExportFile = 0;
+    exportedBytes = 0;
+    exportCancelled = false;
+    exportFinished = false;
+    exportRunning = true;
+    progressValue = 0;
+    exportThread = thread(runExport);
+
+    if (resumedCount > 0) {
+        cout << "Export: " << resumedCount << " files already in " << destDir << ", skipping them" << endl;
+    }
+    setLogMessage("Exporting " + to_string(exportFiles.size()) + " files...");
+    return true;
+}
+
+bool isExportRunning() {
+    return exportRunning;
+}
+
+void checkExportJob() {
+    if (!exportRunning || !exportFinished) {
+        return;
+    }
+    exportThread.join();
+    exportRunning = false;
+    progressValue = 100;
+
+    int exportCount = 0;
+    for (const ExportFile& file : exportFiles) {
+        if (file.ok) {
+            exportCount++;
+        }
+    }
+    if (exportCount == int(exportFiles.size())) {
+        setLogMessage("Exported " + to_string(exportCount) + " files");
+    } else {
+        setLogMessage("Exported " + to_string(exportCount) + " of " + to_string(exportFiles.size()) + " files");
+    }
+
+    // Refresh the file list (some might have been moved or deleted)
+    if (!exportKeepOriginals) {
+        scanRecordingDirectory();
+    }
+}
+
+void cancelExportJob() {
+    if (!exportRunning) {
+        return;
+    }
+    exportCancelled = true;
+    if (exportThread.joinable()) {
+        exportThread.join();
+    }
+    exportRunning = false;
+}
@@ -0,0 +1,19 @@
+#ifndef EXPORT_JOB_H
+#define EXPORT_JOB_H
+
+#include "common.h"
+
+// Copy (or move) recordings to the export directory on background threads.
+// Progress goes to progressValue; returns false if an export is already running.
+bool startExportJob(const vector<string>& files, const string& sourceDir,
+                    const string& destDir, bool keepOriginals);
+
+bool isExportRunning();
+
+// Report a finished export and refresh the file list (main loop)
+void checkExportJob();
+
+// Stop copying and wait for the workers (shutdown)
+void cancelExportJob();
+
+#endif // EXPORT_JOB_H
@@ -0,0 +1,144 @@
+#include "frame_pacing.h"
+
+// Preview schedule for each pacing level, from full rate to the most relaxed
+struct PacingLevel {
+    int previewDivisor;     // present every Nth captured frame
+    bool reducedOverlays;   // skip optional overlay work
+};
+
+static const PacingLevel PACING_LEVELS[] = {
+    {1, false},   // every frame, full overlays
+    {2, false},   // half rate (15 fps at 30 fps capture)
+    {2, true},    // half rate, reduced overlays
+    {3, true},    // third rate, reduced overlays
+};
+static const int PACING_LEVEL_COUNT = sizeof(PACING_LEVELS) / sizeof(PACING_LEVELS[0]);
+
+// Share of the frame budget that triggers shedding / allows recovering
+static const double BUDGET_HIGH_WATERMARK = 0.85;
+static const double BUDGET_LOW_WATERMARK = 0.60;
+
+// Frames the lower-cost estimate must hold before raising the preview rate again
+static const int RECOVERY_FRAMES = 60;
+
+// Smoothing factor for the per-stage cost averages
+static const double COST_SMOOTHING = 0.1;
+
+static double captureRate = 30.0;
+static double frameBudgetMs = 1000.0 / 30.0;
+static bool adaptivePacing = true;
+static int pacingLevel = 0;
+static long frameCounter = 0;
+static int recoveryCounter = 0;
+static bool presentCurrentFrame = true;
+
+// Smoothed cost per stage in ms, and the time spent on the current frame
+static double stageCostMs[STAGE_COUNT] = {0};
+static double reducedOverlayCostMs = -1.0;
+static double currentFrameMs[STAGE_COUNT] = {0};
+
+// Expected per-frame work (excluding capture, which blocks on the camera) at a level
+static double predictedWorkMs(int level) {
+    const PacingLevel& pacing = PACING_LEVELS[level];
+    double overlayMs = stageCostMs[STAGE_OVERLAY];
+    if (pacing.reducedOverlays) {
+        overlayMs = reducedOverlayCostMs >= 0 ? reducedOverlayCostMs : overlayMs * 0.5;
+    }
+    double previewMs = (overlayMs + stageCostMs[STAGE_PREVIEW]) / pacing.previewDivisor;
+    return stageCostMs[STAGE_RECORDING] + stageCostMs[STAGE_DETECTION] + previewMs;
+}
+
+static void smoothCost(double& average, double sample) {
+    average = average * (1.0 - COST_SMOOTHING) + sample * COST_SMOOTHING;
+}
+
+void initFramePacing(double captureFPS, bool adaptive) {
+    captureRate = captureFPS > 0 ? captureFPS : 30.0;
+    frameBudgetMs = 1000.0 / captureRate;
+    adaptivePacing = adaptive;
+    pacingLevel = 0;
+    frameCounter = 0;
+    recoveryCounter = 0;
+    presentCurrentFrame = true;
+    reducedOverlayCostMs = -1.0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stageCostMs[i] = 0;
+        currentFrameMs[i] = 0;
+    }
+}
+
+void recordStageTime(PipelineStage stage, steady_clock::duration elapsed) {
+    currentFrameMs[stage] += duration<double, std::milli>(elapsed).count();
+}
+
+bool shouldPresentFrame() {
+    presentCurrentFrame = !adaptivePacing ||
+                          frameCounter % PACING_LEVELS[pacingLevel].previewDivisor == 0;
+    return presentCurrentFrame;
+}
+
+bool isOverlayReduced() {
+    return adaptivePacing && PACING_LEVELS[pacingLevel].reducedOverlays;
+}
+
+double getPreviewRate() {
+    if (!adaptivePacing) {
+        return captureRate;
+    }
+    return captureRate / PACING_LEVELS[pacingLevel].previewDivisor;
+}
+
+double getFrameBudgetMs() {
+    return frameBudgetMs;
+}
+
+void endFramePacing() {
+    // Higher priority stages run every frame, so their averages include idle frames
+    smoothCost(stageCostMs[STAGE_CAPTURE], currentFrameMs[STAGE_CAPTURE]);
+    smoothCost(stageCostMs[STAGE_RECORDING], currentFrameMs[STAGE_RECORDING]);
+    smoothCost(stageCostMs[STAGE_DETECTION], currentFrameMs[STAGE_DETECTION]);
+
+    // Preview costs are only known for frames that were actually presented
+    if (presentCurrentFrame) {
+        if (isOverlayReduced()) {
+            if (reducedOverlayCostMs < 0) {
+                reducedOverlayCostMs = currentFrameMs[STAGE_OVERLAY];
+            }
+            smoothCost(reducedOverlayCostMs, currentFrameMs[STAGE_OVERLAY]);
+        } else {
+            smoothCost(stageCostMs[STAGE_OVERLAY], currentFrameMs[STAGE_OVERLAY]);
+        }
+        smoothCost(stageCostMs[STAGE_PREVIEW], currentFrameMs[STAGE_PREVIEW]);
+    }
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        currentFrameMs[i] = 0;
+    }
+    frameCounter++;
+
+    if (!adaptivePacing) {
+        return;
+    }
+
+    int previousLevel = pacingLevel;
+    if (predictedWorkMs(pacingLevel) > frameBudgetMs * BUDGET_HIGH_WATERMARK) {
+        // Capture, recording and detection are never shed; lower the preview first
+        if (pacingLevel < PACING_LEVEL_COUNT - 1) {
+            pacingLevel++;
+        }
+        recoveryCounter = 0;
+    } else if (pacingLevel > 0 &&
+               predictedWorkMs(pacingLevel - 1) < frameBudgetMs * BUDGET_LOW_WATERMARK) {
+        if (++recoveryCounter >= RECOVERY_FRAMES) {
+            pacingLevel--;
+            recoveryCounter = 0;
+        }
+    } else {
+        recoveryCounter = 0;
+    }
+
+    if (pacingLevel != previousLevel) {
+        cout << "Preview rate: " << getPreviewRate() << " fps"
+             << (isOverlayReduced() ? " (reduced overlays)" : "") << endl;
+    }
+}
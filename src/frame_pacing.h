@@ -0,0 +1,37 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include "common.h"
+
+// Main loop stages, in priority order (earlier stages are never shed)
+enum PipelineStage {
+    STAGE_CAPTURE = 0,
+    STAGE_RECORDING,
+    STAGE_DETECTION,
+    STAGE_OVERLAY,
+    STAGE_PREVIEW,
+    STAGE_COUNT
+};
+
+// Initialize the scheduler for the camera frame rate
+void initFramePacing(double captureFPS, bool adaptive);
+
+// Report how long a stage took on the current frame
+void recordStageTime(PipelineStage stage, steady_clock::duration elapsed);
+
+// Decide whether the current frame is presented in the preview window
+bool shouldPresentFrame();
+
+// True when optional overlay work should be skipped to save time
+bool isOverlayReduced();
+
+// Preview rate currently chosen by the scheduler
+double getPreviewRate();
+
+// Time available per captured frame
+double getFrameBudgetMs();
+
+// Close the current frame and re-plan the preview rate from the measured costs
+void endFramePacing();
+
+#endif // FRAME_PACING_H
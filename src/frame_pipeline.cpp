@@ -0,0 +1,162 @@
+#include "frame_pipeline.h"
+#include "camera.h"
+#include "ui.h"
+#include "background_subtraction.h"
+#include "export_dialog.h"
+#include "ui_helpers.h"
+#include "navigation_bar.h"
+#include "digital_zoom.h"
+#include "frame_pacing.h"
+#include "latency_stats.h"
+#include "metrics.h"
+#include "clock_service.h"
+
+// Frames written to the current recording and the capture time of the last one
+static int recordedFrames = 0;
+static steady_clock::time_point lastRecordedFrameTime;
+
+bool openRecordingWriter() {
+    // Check if we have valid frame dimensions
+    if (frameSize.width <= 0 || frameSize.height <= 0) {
+        cerr << "ERROR: Invalid frame dimensions: " << frameSize.width << "x" << frameSize.height << endl;
+        isRecording = false;
+        setLogMessage("Error");
+        return false;
+    }
+
+    int codec = VideoWriter::fourcc('M', 'J', 'P', 'G');
+    double fps = appConfig.settings().recordingFps; // Target FPS for raw recording
+
+    // Use temp filename for direct recording to file
+    videoWriter.open(tempFilename, codec, fps, frameSize, true);
+
+    if (!videoWriter.isOpened()) {
+        cerr << "ERROR: Could not open the output video file for write" << endl;
+        isRecording = false;
+        setLogMessage("Error");
+        return false;
+    }
+    recordedFrames = 0;
+    cout << "Started recording to " << tempFilename << endl;
+    setLogMessage("Recording...");
+    return true;
+}
+
+// Copy of the frame the recording overlay is drawn on, reused every frame
+static Mat frameWithOverlay;
+
+// FPS text following the timestamp, reused so drawing it does not allocate
+static string overlayText;
+
+bool writeRecordingFrame(const Mat& frame, double avgFPS) {
+    try {
+        // Add overlays to the frame before saving
+        frame.copyTo(frameWithOverlay);
+
+        // Add date, time and FPS in a single line
+        int textX = drawOverlayTimestamp(frameWithOverlay, Point(10, 30), TEXT_COLOR);
+        if (showFPS) {
+            char fpsBuffer[32];
+            snprintf(fpsBuffer, sizeof(fpsBuffer), " FPS: %d", int(avgFPS));
+            overlayText.assign(fpsBuffer);
+            putText(frameWithOverlay, overlayText, Point(textX, 30),
+                    FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
+        }
+
+        videoWriter.write(frameWithOverlay);
+        countMetric(METRIC_FRAMES_RECORDED);
+
+        // The recording's timing comes from the capture stamps of its frames
+        if (recordedFrames == 0) {
+            recordingStartTime = frameCaptureTime;
+        }
+        lastRecordedFrameTime = frameCaptureTime;
+        recordedFrames++;
+    } catch (const cv::Exception& e) {
+        cerr << "ERROR: Exception while writing video: " << e.what() << endl;
+        countMetric(METRIC_RECORDING_ERRORS);
+        videoWriter.release();
+        isRecording = false;
+        setLogMessage("Error");
+        return false;
+    }
+    return true;
+}
+
+double getRecordedSeconds() {
+    if (recordedFrames < 2) {
+        return 0.0;
+    }
+    // n frames span n - 1 capture intervals; count the last frame's interval too
+    double span = duration<double>(lastRecordedFrameTime - recordingStartTime).count();
+    return span * recordedFrames / (recordedFrames - 1);
+}
+
+void drawPreviewOverlays(Mat& uiFrame, int windowWidth, double avgFPS) {
+    // Display date, time and FPS on the video
+    int textX = drawOverlayTimestamp(uiFrame, Point(10, 30), TEXT_COLOR);
+    if (showFPS) {
+        char fpsBuffer[48];
+        snprintf(fpsBuffer, sizeof(fpsBuffer), " FPS: %d Preview: %d",
+                 int(avgFPS), int(getPreviewRate() + 0.5));
+        overlayText.assign(fpsBuffer);
+        putText(uiFrame, overlayText, Point(textX, 30), FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
+    }
+    if (isDigitalZoomActive()) {
+        char zoomBuffer[16];
+        snprintf(zoomBuffer, sizeof(zoomBuffer), "x%.1f", getDigitalZoom());
+        putText(uiFrame, zoomBuffer, Point(10, 60), FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
+    }
+
+    // Show recording indicator in top-right corner if recording
+    if (isRecording) {
+        // Position the recording indicator to avoid conflict with minimize/close buttons
+        int recIndicatorX = minimizeButtonRect.x - 140; // Leave space for text
+        Rect recIndicator(recIndicatorX, 10, 20, 20);
+        circle(uiFrame, Point(recIndicator.x + 10, recIndicator.y + 10), 10, Scalar(0, 0, 255), -1);
+
+        // Show recording time
+        duration<double> elapsedSecs = frameCaptureTime - recordingStartTime;
+        int elapsed = max(0, static_cast<int>(elapsedSecs.count()));
+        int mins = elapsed / 60;
+        int secs = elapsed % 60;
+        char timeBuffer[16];
+        snprintf(timeBuffer, sizeof(timeBuffer), "%02d:%02d", mins, secs);
+
+        // Display recording time next to the red dot
+        Point timePos(recIndicator.x + 25, recIndicator.y + 15);
+        putText(uiFrame, timeBuffer, timePos, FONT_HERSHEY_SIMPLEX, UI_FONT_SIZE, Scalar(255, 255, 255), 2);
+    }
+
+    // Draw navigation bar if visible
+    if (showNavBar) {
+        drawNavigationBar(uiFrame, windowWidth, isRecording, isProcessing, isZoomInHeld, isZoomOutHeld);
+    }
+
+    // Update toggle button position and draw it
+    updateToggleButtonPosition(windowWidth);
+
+    if (showNavBar) {
+        // Draw down arrow (to hide navigation bar)
+        downArrowImage.copyTo(uiFrame(toggleNavButtonRect));
+    } else {
+        // Draw up arrow (to show navigation bar)
+        upArrowImage.copyTo(uiFrame(toggleNavButtonRect));
+    }
+
+    if (showExportDialog) {
+        drawExportDialog(uiFrame);
+    }
+
+    // Draw window controls
+    drawWindowControls(uiFrame);
+
+    // Draw background subtraction controls
+    drawBgSubControls(uiFrame, bgSubtractionActive);
+    drawIR(uiFrame, bgSubtractionActive);
+
+    // Where the frame budget goes, per stage
+    if (showLatencyPanel) {
+        drawLatencyPanel(uiFrame, getFrameBudgetMs());
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include "common.h"
+
+// Per-frame stages of the main loop. The application and the frame loop
+// benchmark both run them, so the benchmark measures the code that ships.
+
+// Open videoWriter on tempFilename for a recording that was just started;
+// the recording is stopped if that fails
+bool openRecordingWriter();
+
+// Stamp the date, time (and FPS) on a copy of the frame and append it to the
+// recording; returns false, with the recording stopped, when the write fails
+bool writeRecordingFrame(const Mat& frame, double avgFPS);
+
+// Length of the current recording from the capture times of its frames
+double getRecordedSeconds();
+
+// Time stamp, recording indicator, navigation bar, dialogs and panels over the preview
+void drawPreviewOverlays(Mat& uiFrame, int windowWidth, double avgFPS);
+
+#endif // FRAME_PIPELINE_H
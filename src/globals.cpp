@@ -0,0 +1,158 @@
+#include "common.h"
+
+// Globals shared by the modules (declared in common.h). They live apart from
+// main() so the benchmarks can link the application's modules.
+bool showExportDialog = false;
+Rect exportDialogRect;
+string exportDestDir = "./recordings/";
+vector<string> recordingFiles;
+vector<bool> fileSelection;
+bool keepOriginalFiles = true;
+int scrollOffset = 0;
+const int maxFilesVisible = 10;
+Rect fileListRect;
+Rect dirSelectRect;
+Rect keepFilesRect;
+Rect exportConfirmRect;
+Rect exportCancelRect;
+Rect scrollUpRect;
+Rect scrollDownRect;
+
+queue<Mat> frameQueue;
+mutex queueMutex;
+condition_variable frameCondition;
+atomic<bool> recordingThreadActive(false);
+thread recordingThread;
+double recordingDurationSeconds = 0.0;
+
+// Define global variables
+bool isRecording = false;
+VideoWriter videoWriter;
+string filename;
+string tempFilename;
+bool isFirstFrame = true;
+Size frameSize;
+steady_clock::time_point frameCaptureTime;
+steady_clock::time_point recordingStartTime;
+int recordingDetectionEvents = 0;
+int WIDTH = 1280;
+int HEIGHT = 720;
+int DISPLAY_WIDTH = 1280;
+int DISPLAY_HEIGHT = 800;
+
+// Thread-related variables
+thread processingThread;
+atomic<bool> isProcessing(false);
+mutex frameMutex;
+
+// Directory dialog variables
+atomic<bool> directoryDialogActive(false);
+mutex directoryResultMutex;
+string selectedDirectoryResult = "";
+bool directoryResultReady = false;
+
+// Zoom control variables
+int zoomLevel = 0;
+int maxZoomLevel = 0x4000;
+Rect zoomInButtonRect;
+Rect zoomOutButtonRect;
+atomic<bool> serialInitialized(false);
+
+// Button holding state variables
+bool isZoomInHeld = false;
+bool isZoomOutHeld = false;
+steady_clock::time_point lastZoomTime;
+int ZOOM_DELAY_MS = 100;
+int ZOOM_STEP = 512;
+bool continuousZoom = false;
+int ZOOM_SPEED = 4;
+
+// Background subtraction parameters
+bool showBgSubControls = true;
+int lowerBound = 0;
+int upperBound = 200;
+int minContourArea = 0;
+int maxContourArea = 300;
+Rect bgSubControlsRect;
+Rect bgSubSliderRect;
+Rect toggleBgSubControlsRect;
+
+// New control variables for ICR and IR Correction
+bool icrModeEnabled = false;
+bool irCorrectionEnabled = false;
+Rect icrButtonRect;
+Rect irCorrectionButtonRect;
+
+bool isDraggingMinHandle = false;
+bool isDraggingMaxHandle = false;
+
+// Display options
+bool showFPS = false;
+bool showNavBar = true;
+Rect navBarRect;
+Rect toggleNavButtonRect;
+Mat upArrowImage;
+Mat downArrowImage;
+
+// Theme colors
+Scalar THEME_COLOR = Scalar(20, 60, 20);
+Scalar PROGRESS_BAR_COLOR = Scalar(0, 200, 0);
+Scalar TEXT_COLOR = Scalar(220, 220, 220);
+Scalar BUTTON_COLOR = Scalar(0, 204, 0);
+Scalar BUTTON_TEXT_COLOR = Scalar(240, 240, 240);
+Scalar HIGHLIGHT_COLOR = Scalar(40, 120, 40);
+
+// UI layout parameters
+int UI_FONT_SIZE = 1;
+int PADDING = 10;
+int BTN_HEIGHT = 60;
+int NAV_BAR_HEIGHT = 80;
+int NAV_BUTTON_SIZE = 40;
+
+// UI components
+Rect videoRect;
+Rect recordButtonRect;
+Rect progressBarRect;
+Rect logLabelRect;
+Rect exportButtonRect;
+Rect logoRect;
+Rect panUpButtonRect;
+Rect panDownButtonRect;
+
+// Window control buttons
+Rect minimizeButtonRect;
+Rect closeButtonRect;
+
+// Progress bar variables
+atomic<int> progressValue(0);
+const int progressMax = 100;
+
+// Log message
+string logMessage = "";
+mutex logMutex;
+
+int isFullscreen = true;
+
+bool bgSubtractionActive = false;
+Rect bgSubtractionRect;
+Ptr<BackgroundSubtractorMOG2> backgroundSubtractor;
+std::map<cv::Point, std::vector<std::pair<int, float>>, PointCompare> objectOccurrences;
+int frameNumber = 0;
+std::vector<cv::Point> detectionPoints;
+std::map<cv::Point, int, PointCompare> detectionCounts;
+
+steady_clock::time_point bgSubStartTime;
+const int BG_SUB_TIMEOUT_SECONDS = 10;
+bool isTimedOut = false;
+
+// Function to safely update log message
+void setLogMessage(const string& message) {
+    lock_guard<mutex> lock(logMutex);
+    logMessage = message;
+}
+
+// Function to safely get log message
+string getLogMessage() {
+    lock_guard<mutex> lock(logMutex);
+    return logMessage;
+}
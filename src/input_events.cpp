@@ -0,0 +1,47 @@
+#include "input_events.h"
+#include "ui.h"
+
+// Upper bound on queued events, older mouse moves are dropped first
+static const size_t MAX_QUEUED_EVENTS = 256;
+
+static vector<InputEvent> pendingEvents;
+static vector<InputEvent> activeEvents;
+static mutex inputEventMutex;
+
+void pushInputEvent(const InputEvent& inputEvent) {
+    lock_guard<mutex> lock(inputEventMutex);
+
+    // Consecutive mouse moves only matter for their latest position
+    if (inputEvent.event == EVENT_MOUSEMOVE && !pendingEvents.empty() &&
+        pendingEvents.back().event == EVENT_MOUSEMOVE &&
+        pendingEvents.back().flags == inputEvent.flags) {
+        pendingEvents.back() = inputEvent;
+        return;
+    }
+
+    if (pendingEvents.size() >= MAX_QUEUED_EVENTS) {
+        auto it = find_if(pendingEvents.begin(), pendingEvents.end(),
+                          [](const InputEvent& e) { return e.event == EVENT_MOUSEMOVE; });
+        if (it == pendingEvents.end()) {
+            return;
+        }
+        pendingEvents.erase(it);
+    }
+    pendingEvents.push_back(inputEvent);
+}
+
+void processInputEvents() {
+    {
+        lock_guard<mutex> lock(inputEventMutex);
+        if (pendingEvents.empty()) {
+            return;
+        }
+        // Swap so the callback can keep queueing while we apply
+        activeEvents.swap(pendingEvents);
+    }
+
+    for (const InputEvent& inputEvent : activeEvents) {
+        handleMouseEvent(inputEvent.event, inputEvent.x, inputEvent.y, inputEvent.flags);
+    }
+    activeEvents.clear();
+}
@@ -0,0 +1,20 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+
+#include "common.h"
+
+// Mouse event as delivered by HighGUI
+struct InputEvent {
+    int event;
+    int x;
+    int y;
+    int flags;
+};
+
+// Queue an event (called from the HighGUI mouse callback)
+void pushInputEvent(const InputEvent& inputEvent);
+
+// Apply all queued events; called once per frame from the main loop
+void processInputEvents();
+
+#endif // INPUT_EVENTS_H
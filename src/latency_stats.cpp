@@ -0,0 +1,234 @@
+#include "latency_stats.h"
+
+bool showLatencyPanel = false;
+
+// Log-linear buckets over microseconds, as in HDR histograms: values below 16 us
+// get a bucket each, above that every power of two is split into 16 buckets,
+// so any recorded value is within 1/16 (6%) of its bucket.
+static const int SUB_BUCKET_BITS = 4;
+static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+static const int MAX_EXPONENT = 22;     // up to 2^27 us, about two minutes
+static const int BUCKET_COUNT = SUB_BUCKETS * (MAX_EXPONENT + 2);
+
+// The panel is recomputed at this rate, not every frame
+static const int PANEL_REFRESH_MS = 500;
+
+struct LatencyHistogram {
+    atomic<uint32_t> buckets[BUCKET_COUNT];
+    atomic<uint64_t> count;
+    atomic<uint64_t> totalMicros;
+    atomic<uint64_t> maxMicros;
+    atomic<uint64_t> allocations;
+    atomic<uint64_t> allocatedBytes;
+};
+
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+
+// Frames closed by recordFrameAllocations() since the last reset
+static atomic<uint64_t> allocationFrames(0);
+
+// Allocation counters at the start of the open stage and frame, per thread
+static thread_local AllocCount stageMark = {0, 0};
+static thread_local AllocCount frameMark = {0, 0};
+
+static const char* STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+    "capture", "detection", "recording", "resize", "overlay", "imshow", "waitKey", "frame"
+};
+
+static int bucketIndex(uint64_t micros) {
+    if (micros < SUB_BUCKETS) {
+        return int(micros);
+    }
+    int exponent = 63 - __builtin_clzll(micros) - SUB_BUCKET_BITS;
+    int index = SUB_BUCKETS * exponent + int(micros >> exponent);
+    return min(index, BUCKET_COUNT - 1);
+}
+
+// Largest value that falls into a bucket
+static uint64_t bucketUpperMicros(int index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = index / SUB_BUCKETS - 1;
+    uint64_t subBucket = index - SUB_BUCKETS * exponent;
+    return ((subBucket + 1) << exponent) - 1;
+}
+
+static_assert(BUCKET_COUNT - 1 == SUB_BUCKETS * MAX_EXPONENT + (2 * SUB_BUCKETS - 1),
+              "Last bucket must hold the largest exponent");
+
+const char* latencyStageName(LatencyStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+void recordLatency(LatencyStage stage, steady_clock::duration elapsed) {
+    uint64_t micros = uint64_t(max<int64_t>(0, duration_cast<microseconds>(elapsed).count()));
+    LatencyHistogram& histogram = histograms[stage];
+    histogram.buckets[bucketIndex(micros)].fetch_add(1, memory_order_relaxed);
+    histogram.count.fetch_add(1, memory_order_relaxed);
+    histogram.totalMicros.fetch_add(micros, memory_order_relaxed);
+
+    uint64_t previousMax = histogram.maxMicros.load(memory_order_relaxed);
+    while (micros > previousMax &&
+           !histogram.maxMicros.compare_exchange_weak(previousMax, micros, memory_order_relaxed)) {
+    }
+}
+
+static void addAllocations(LatencyStage stage, AllocCount& mark) {
+    AllocCount now = threadAllocCount();
+    histograms[stage].allocations.fetch_add(now.allocations - mark.allocations, memory_order_relaxed);
+    histograms[stage].allocatedBytes.fetch_add(now.bytes - mark.bytes, memory_order_relaxed);
+    mark = now;
+}
+
+void markStageAllocations() {
+    stageMark = threadAllocCount();
+}
+
+void recordStageAllocations(LatencyStage stage) {
+    addAllocations(stage, stageMark);
+}
+
+void recordFrameAllocations() {
+    if (!allocTrackingEnabled.load(memory_order_relaxed)) {
+        return;
+    }
+    addAllocations(LATENCY_FRAME, frameMark);
+    allocationFrames.fetch_add(1, memory_order_relaxed);
+}
+
+LatencySummary getLatencySummary(LatencyStage stage) {
+    const LatencyHistogram& histogram = histograms[stage];
+    uint32_t counts[BUCKET_COUNT];
+    uint64_t count = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = histogram.buckets[i].load(memory_order_relaxed);
+        count += counts[i];
+    }
+
+    LatencySummary summary = {};
+    summary.count = count;
+    if (count == 0) {
+        return summary;
+    }
+    summary.meanMs = histogram.totalMicros.load(memory_order_relaxed) / 1000.0 /
+                     max<uint64_t>(1, histogram.count.load(memory_order_relaxed));
+    summary.maxMs = histogram.maxMicros.load(memory_order_relaxed) / 1000.0;
+    uint64_t frames = allocationFrames.load(memory_order_relaxed);
+    if (frames > 0) {
+        summary.allocationsPerFrame = double(histogram.allocations.load(memory_order_relaxed)) / frames;
+        summary.bytesPerFrame = double(histogram.allocatedBytes.load(memory_order_relaxed)) / frames;
+    }
+
+    // Walk the buckets once, filling each percentile as its rank is passed
+    const double percentiles[] = {0.50, 0.95, 0.99};
+    double* results[] = {&summary.p50Ms, &summary.p95Ms, &summary.p99Ms};
+    int next = 0;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT && next < 3; i++) {
+        seen += counts[i];
+        while (next < 3 && seen >= uint64_t(ceil(percentiles[next] * count))) {
+            *results[next++] = min(double(bucketUpperMicros(i)) / 1000.0, summary.maxMs);
+        }
+    }
+    return summary;
+}
+
+void resetLatencyStats() {
+    for (LatencyHistogram& histogram : histograms) {
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, memory_order_relaxed);
+        }
+        histogram.count.store(0, memory_order_relaxed);
+        histogram.totalMicros.store(0, memory_order_relaxed);
+        histogram.maxMicros.store(0, memory_order_relaxed);
+        histogram.allocations.store(0, memory_order_relaxed);
+        histogram.allocatedBytes.store(0, memory_order_relaxed);
+    }
+    allocationFrames.store(0, memory_order_relaxed);
+
+    // The calling thread (the main loop) starts counting from here
+    stageMark = frameMark = threadAllocCount();
+}
+
+bool dumpLatencyStats(const string& path) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Failed to write latency stats to " << path << endl;
+        return false;
+    }
+
+    file << "# stage count mean_ms p50_ms p95_ms p99_ms max_ms allocs_per_frame bytes_per_frame\n"
+         << fixed << setprecision(3);
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        LatencySummary summary = getLatencySummary(LatencyStage(stage));
+        file << STAGE_NAMES[stage] << ' ' << summary.count << ' ' << summary.meanMs << ' '
+             << summary.p50Ms << ' ' << summary.p95Ms << ' ' << summary.p99Ms << ' '
+             << summary.maxMs << ' ' << summary.allocationsPerFrame << ' '
+             << summary.bytesPerFrame << '\n';
+    }
+
+    // Non-empty buckets as "upper_bound_us:count", enough to rebuild the distribution
+    file << "\n# histograms\n";
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        file << STAGE_NAMES[stage];
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            uint32_t count = histograms[stage].buckets[i].load(memory_order_relaxed);
+            if (count > 0) {
+                file << ' ' << bucketUpperMicros(i) << ':' << count;
+            }
+        }
+        file << '\n';
+    }
+    return true;
+}
+
+void drawLatencyPanel(Mat& img, double frameBudgetMs) {
+    static vector<array<string, 7>> rows;
+    static string budgetLine;
+    static steady_clock::time_point refreshedAt;
+
+    steady_clock::time_point now = steady_clock::now();
+    if (rows.empty() || now - refreshedAt >= milliseconds(PANEL_REFRESH_MS)) {
+        refreshedAt = now;
+        rows.clear();
+        rows.push_back({"ms", "p50", "p95", "p99", "max", "alloc", "KB"});
+
+        auto format = [](double ms) {
+            char text[16];
+            snprintf(text, sizeof(text), "%.1f", ms);
+            return string(text);
+        };
+        double workMs = 0;
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            LatencySummary summary = getLatencySummary(LatencyStage(stage));
+            rows.push_back({STAGE_NAMES[stage], format(summary.p50Ms), format(summary.p95Ms),
+                            format(summary.p99Ms), format(summary.maxMs),
+                            format(summary.allocationsPerFrame), format(summary.bytesPerFrame / 1024)});
+            if (stage != LATENCY_FRAME && stage != LATENCY_WAITKEY) {
+                workMs += summary.meanMs;
+            }
+        }
+        budgetLine = "budget " + format(frameBudgetMs) + "  mean work " + format(workMs);
+    }
+
+    // Fixed column positions, the Hershey fonts are not monospaced
+    const int lineHeight = 18;
+    // Allocation columns only while allocations are counted
+    const int columnX[7] = {8, 100, 160, 220, 280, 340, 410};
+    int columns = allocTrackingEnabled.load(memory_order_relaxed) ? 7 : 5;
+    Rect panel(10, 80, columns == 7 ? 480 : 340, lineHeight * int(rows.size() + 1) + 10);
+    if ((panel & Rect(0, 0, img.cols, img.rows)) != panel) {
+        return;
+    }
+    rectangle(img, panel, Scalar(20, 20, 20), -1);
+    for (size_t i = 0; i < rows.size(); i++) {
+        for (int column = 0; column < columns; column++) {
+            putText(img, rows[i][column],
+                    Point(panel.x + columnX[column], panel.y + lineHeight * int(i + 1)),
+                    FONT_HERSHEY_PLAIN, 1.0, TEXT_COLOR, 1);
+        }
+    }
+    putText(img, budgetLine, Point(panel.x + columnX[0], panel.y + lineHeight * int(rows.size() + 1)),
+            FONT_HERSHEY_PLAIN, 1.0, TEXT_COLOR, 1);
+}
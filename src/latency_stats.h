@@ -0,0 +1,93 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include "common.h"
+#include "trace.h"
+#include "alloc_stats.h"
+
+// Main loop steps that are timed every frame
+enum LatencyStage {
+    LATENCY_CAPTURE = 0,
+    LATENCY_DETECTION,
+    LATENCY_RECORDING,
+    LATENCY_RESIZE,
+    LATENCY_OVERLAY,
+    LATENCY_IMSHOW,
+    LATENCY_WAITKEY,
+    LATENCY_FRAME,          // whole loop iteration, capture to capture
+    LATENCY_STAGE_COUNT
+};
+
+// Summary of one stage, in milliseconds
+struct LatencySummary {
+    uint64_t count;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+    double allocationsPerFrame;     // heap allocations, while allocation tracking is on
+    double bytesPerFrame;
+};
+
+extern bool showLatencyPanel;   // On-screen latency panel, toggled with 'l'
+
+const char* latencyStageName(LatencyStage stage);
+
+// Add a sample; safe from any thread, never blocks
+void recordLatency(LatencyStage stage, steady_clock::duration elapsed);
+
+// Allocations of the calling thread since the last markStageAllocations() go to the stage
+void markStageAllocations();
+void recordStageAllocations(LatencyStage stage);
+
+// Close a frame for the per-frame allocation averages (whole loop iteration)
+void recordFrameAllocations();
+
+// Start time of a stage; also marks the allocation counters when tracking is on
+inline steady_clock::time_point startStage() {
+    if (allocTrackingEnabled.load(memory_order_relaxed)) {
+        markStageAllocations();
+    }
+    return steady_clock::now();
+}
+
+// Add the time since start and return it (for passing on to the frame pacer);
+// the same interval goes into the trace when tracing is on
+inline steady_clock::duration recordLatency(LatencyStage stage, steady_clock::time_point start) {
+    steady_clock::time_point end = steady_clock::now();
+    recordLatency(stage, end - start);
+    if (allocTrackingEnabled.load(memory_order_relaxed)) {
+        recordStageAllocations(stage);
+    }
+    if (traceEnabled.load(memory_order_relaxed)) {
+        traceEvent(latencyStageName(stage), start, end);
+    }
+    return end - start;
+}
+
+// Times the enclosing scope
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStage stage) : stage(stage), start(startStage()) {}
+    ~ScopedLatency() { recordLatency(stage, start); }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+private:
+    LatencyStage stage;
+    steady_clock::time_point start;
+};
+
+LatencySummary getLatencySummary(LatencyStage stage);
+
+// Start a new measurement period
+void resetLatencyStats();
+
+// Write every stage summary plus the raw histograms, returns false on failure
+bool dumpLatencyStats(const string& path);
+
+// Table of p50/p95/p99/max per stage against the frame budget, plus
+// allocations and KB per frame while allocation tracking is on
+void drawLatencyPanel(Mat& img, double frameBudgetMs);
+
+#endif // LATENCY_STATS_H
@@ -8,180 +8,93 @@
 #include "export_dialog.h"
 #include "ui_helpers.h"
 #include "navigation_bar.h"
-
-// Global variables that need to be in main
+#include "digital_zoom.h"
+#include "frame_pacing.h"
+#include "frame_pipeline.h"
+#include "input_events.h"
+#include "config_watcher.h"
+#include "serial_worker.h"
+#include "camera_state.h"
+#include "export_job.h"
+#include "recordings_catalog.h"
+#include "thumbnail_job.h"
+#include "latency_stats.h"
+#include "trace.h"
+#include "metrics.h"
+#include "mat_pool.h"
+#include "clock_service.h"
+
+// The application settings; the other globals are defined in globals.cpp
 Config appConfig;
-bool showExportDialog = false;
-Rect exportDialogRect;
-string exportDestDir = "./recordings/";
-vector<string> recordingFiles;
-vector<bool> fileSelection;
-bool keepOriginalFiles = true;
-int scrollOffset = 0;
-const int maxFilesVisible = 10;
-Rect fileListRect;
-Rect dirSelectRect;
-Rect keepFilesRect;
-Rect exportConfirmRect;
-Rect exportCancelRect;
-Rect scrollUpRect;
-Rect scrollDownRect;
-
-queue<Mat> frameQueue;
-mutex queueMutex;
-condition_variable frameCondition;
-atomic<bool> recordingThreadActive(false);
-thread recordingThread;
-double recordingDurationSeconds = 0.0;
-
-// Define global variables
-bool isRecording = false;
-VideoWriter videoWriter;
-string filename;
-string tempFilename;
-bool isFirstFrame = true;
-Size frameSize;
-deque<double> fpsHistory;
-const int FPS_HISTORY_SIZE = 30;
-system_clock::time_point recordingStartTime;
-int WIDTH = 1280;
-int HEIGHT = 720;
-int DISPLAY_WIDTH = 1280;
-int DISPLAY_HEIGHT = 800;
-
-// Thread-related variables
-thread processingThread;
-atomic<bool> isProcessing(false);
-mutex frameMutex;
-
-// Directory dialog variables
-atomic<bool> directoryDialogActive(false);
-mutex directoryResultMutex;
-string selectedDirectoryResult = "";
-bool directoryResultReady = false;
-
-// Zoom control variables
-int zoomLevel = 0;
-int maxZoomLevel = 0x4000;
-Rect zoomInButtonRect;
-Rect zoomOutButtonRect;
-bool serialInitialized = false;
-
-// Button holding state variables
-bool isZoomInHeld = false;
-bool isZoomOutHeld = false;
-system_clock::time_point lastZoomTime;
-int ZOOM_DELAY_MS = 100;
-
-// Background subtraction parameters
-bool showBgSubControls = true;
-int lowerBound = 0;
-int upperBound = 200;
-int minContourArea = 0;
-int maxContourArea = 300;
-Rect bgSubControlsRect;
-Rect bgSubSliderRect;
-Rect toggleBgSubControlsRect;
-
-// New control variables for ICR and IR Correction
-bool icrModeEnabled = false;
-bool irCorrectionEnabled = false;
-Rect icrButtonRect;
-Rect irCorrectionButtonRect;
-
-bool isDraggingMinHandle = false;
-bool isDraggingMaxHandle = false;
-
-// Display options
-bool showFPS = false;
-bool showNavBar = true;
-Rect navBarRect;
-Rect toggleNavButtonRect;
-Mat upArrowImage;
-Mat downArrowImage;
-
-// Theme colors
-Scalar THEME_COLOR = Scalar(20, 60, 20);
-Scalar PROGRESS_BAR_COLOR = Scalar(0, 200, 0);
-Scalar TEXT_COLOR = Scalar(220, 220, 220);
-Scalar BUTTON_COLOR = Scalar(0, 204, 0);
-Scalar BUTTON_TEXT_COLOR = Scalar(240, 240, 240);
-Scalar HIGHLIGHT_COLOR = Scalar(40, 120, 40);
-
-// UI layout parameters
-int UI_FONT_SIZE = 1;
-int PADDING = 10;
-int BTN_HEIGHT = 60;
-int NAV_BAR_HEIGHT = 80;
-int NAV_BUTTON_SIZE = 40;
-
-// UI components
-Rect videoRect;
-Rect recordButtonRect;
-Rect progressBarRect;
-Rect logLabelRect;
-Rect exportButtonRect;
-Rect logoRect;
-Rect panUpButtonRect;
-Rect panDownButtonRect;
-
-// Window control buttons
-Rect minimizeButtonRect;
-Rect closeButtonRect;
-
-// Progress bar variables
-atomic<int> progressValue(0);
-const int progressMax = 100;
-
-// Log message
-string logMessage = "";
-mutex logMutex;
-
-int isFullscreen = true;
-
-bool bgSubtractionActive = false;
-Rect bgSubtractionRect;
-Ptr<BackgroundSubtractorMOG2> backgroundSubtractor;
-std::map<std::string, std::vector<std::map<int, float>>> objectOccurrences;
-int frameNumber = 0;
-std::vector<cv::Point> detectionPoints;
-std::map<cv::Point, int, PointCompare> detectionCounts;
-
-std::chrono::time_point<std::chrono::system_clock> bgSubStartTime;
-const int BG_SUB_TIMEOUT_SECONDS = 10;
-bool isTimedOut = false;
-
-// Function to safely update log message
-void setLogMessage(const string& message) {
-    lock_guard<mutex> lock(logMutex);
-    logMessage = message;
-}
 
-// Function to safely get log message
-string getLogMessage() {
-    lock_guard<mutex> lock(logMutex);
-    return logMessage;
+// Apply settings that can change while running (startup and config reload)
+void applyRuntimeSettings(const Config& config) {
+    const Settings& settings = config.settings();
+    showFPS = settings.showFps;
+    showLatencyPanel = settings.showLatency;
+    showNavBar = settings.showNavBar;
+    showBgSubControls = settings.showBgSubControls;
+    updateBgSubControlsTogglePosition(showBgSubControls);
+    lowerBound = settings.lowerBound;
+    upperBound = settings.upperBound;
+    minContourArea = settings.minContourArea;
+    maxContourArea = settings.maxContourArea;
+    ZOOM_STEP = settings.zoomStep;
+    continuousZoom = settings.continuousZoom;
+    ZOOM_SPEED = settings.zoomSpeed;
 }
 
 int main(int argc, char** argv) {
     // Load configuration
     appConfig.loadConfig();
+    // Copied: startup values outlive the snapshots reloads retire
+    const Settings settings = appConfig.settings();
 
     // Apply configuration settings
-    DISPLAY_WIDTH = appConfig.getInt("DISPLAY_WIDTH", 1280);
-    DISPLAY_HEIGHT = appConfig.getInt("DISPLAY_HEIGHT", 800);
-    WIDTH = appConfig.getInt("CAMERA_WIDTH", 1280);
-    HEIGHT = appConfig.getInt("CAMERA_HEIGHT", 720);
-    exportDestDir = appConfig.getString("EXPORT_DEST_DIR", "./recordings/");
-    keepOriginalFiles = appConfig.getBool("KEEP_ORIGINAL_FILES", true);
-    showFPS = appConfig.getBool("SHOW_FPS", false);
-    showNavBar = appConfig.getBool("SHOW_NAV_BAR", true);
-    bool useFullscreen = appConfig.getBool("FULL_SCREEN", true);
-    lowerBound = appConfig.getInt("LOWERBOUND", 50);
-    upperBound = appConfig.getInt("UPPERBOUND", 200);
-    minContourArea = appConfig.getInt("MIN_CONTOUR_AREA", 0);
-    maxContourArea = appConfig.getInt("MAX_CONTOUR_AREA", 300);
-    showBgSubControls = appConfig.getBool("SHOW_BG_SUB_CONTROLS", true);
+    DISPLAY_WIDTH = settings.displayWidth;
+    DISPLAY_HEIGHT = settings.displayHeight;
+    WIDTH = settings.cameraWidth;
+    HEIGHT = settings.cameraHeight;
+    exportDestDir = settings.exportDestDir;
+    keepOriginalFiles = settings.keepOriginalFiles;
+    bool useFullscreen = settings.fullScreen;
+    applyRuntimeSettings(appConfig);
+
+    // Detector bounds, zoom step and display options follow config.ini edits
+    appConfig.subscribe(applyRuntimeSettings);
+    appConfig.dispatchChanges();
+    startConfigWatcher();
+
+    // Pipeline trace: recorded from startup with TRACE, toggled with 't', saved on SIGUSR1
+    setTraceThreadName("main");
+    installTraceSignal();
+    if (settings.trace) {
+        startTracing();
+    }
+
+    // Frame buffers are recycled instead of going back to the heap every frame;
+    // installed before the frame loop creates its buffers
+    if (settings.matPool) {
+        installMatPool();
+    }
+
+    // Heap allocations per stage, counted when ALLOC_STATS is set or 'a' is pressed
+    if (settings.allocStats) {
+        startAllocTracking();
+    }
+
+    // Prometheus endpoint for fleet monitoring, off unless METRICS_PORT is set
+    if (settings.metricsPort > 0) {
+        startMetricsServer(settings.metricsPort);
+    }
+
+    // Camera serial commands are sent from their own thread
+    startSerialWorker();
+
+    // Recordings list for the export dialog, kept current in the background,
+    // and the idle-priority thread that builds their preview strips
+    startThumbnailJob();
+    startRecordingsCatalog();
     
     // Create a window with a specific size
     int windowWidth = DISPLAY_WIDTH;
@@ -211,9 +124,10 @@ int main(int argc, char** argv) {
     // Update toggle button position
     updateToggleButtonPosition(windowWidth);
 
-    // Configure camera
+    // Configure camera (or the video file / synthetic scene set in FRAME_SOURCE)
     VideoCapture cap;
-    cameraConfig(&cap);
+    double sourceFPS;
+    openFrameSource(&cap, settings.frameSource, sourceFPS);
 
     Mat frame;
     Mat uiFrame(DISPLAY_HEIGHT, DISPLAY_WIDTH, CV_8UC3, THEME_COLOR);
@@ -221,8 +135,7 @@ int main(int argc, char** argv) {
     setLogMessage("");
 
     bool videoWriterInitialized = false;
-    system_clock::time_point previousFrameTime = system_clock::now();
-    double currentFPS = 0.0;
+    steady_clock::time_point previousFrameTime = steady_clock::now();
 
     // Load record and stop images/icons
     Mat recIcon(BTN_HEIGHT, BTN_HEIGHT, CV_8UC3, Scalar(0, 200, 0));  // Green
@@ -236,39 +149,40 @@ int main(int argc, char** argv) {
     // Create overlay for navigation bar
     Mat navBarOverlay(NAV_BAR_HEIGHT, windowWidth, CV_8UC3, Scalar(40, 40, 40));
 
+    // Shed preview work first when the frame budget is at risk
+    initFramePacing(sourceFPS, appConfig.settings().adaptivePreview);
+
     while (true) {
         if (getWindowProperty("Water Dripping Investigation Recording Tools", WND_PROP_VISIBLE) < 1) {
             cout << "Window closed, exiting..." << endl;
             break;
         }
 
-        bool frameRead = cap.read(frame);
+        steady_clock::time_point stageStart = startStage();
+        bool frameRead = readFrame(&cap, frame, frameCaptureTime);
+        recordStageTime(STAGE_CAPTURE, recordLatency(LATENCY_CAPTURE, stageStart));
         if (!frameRead || frame.empty()) {
             cerr << "ERROR: Unable to grab from the camera" << endl;
             setLogMessage("Error");
             break;
         }
+        countMetric(METRIC_FRAMES_CAPTURED);
+
+        // Date and time for this frame's overlays, shared by preview and recording
+        updateOverlayClock();
         
         if (frameRead && !frame.empty()) {
             // Process background subtraction if active
+            stageStart = startStage();
             processBackgroundSubtraction(frame);
+            recordStageTime(STAGE_DETECTION, recordLatency(LATENCY_DETECTION, stageStart));
         }
         
-        // Calculate FPS
-        currentFPS = calculateFPS(previousFrameTime);
-
-        // Update FPS history
-        fpsHistory.push_back(currentFPS);
-        if (fpsHistory.size() > FPS_HISTORY_SIZE) {
-            fpsHistory.pop_front();
-        }
-
-        // Calculate average FPS from history
-        double avgFPS = 0;
-        for (const auto& fps : fpsHistory) {
-            avgFPS += fps;
-        }
-        avgFPS = avgFPS / fpsHistory.size();
+        // Average FPS over the recent frames
+        double avgFPS = calculateFPS(frameCaptureTime, previousFrameTime);
+        setMetricGauge(GAUGE_CAPTURE_FPS, avgFPS);
+        setMetricGauge(GAUGE_PREVIEW_FPS, getPreviewRate());
+        setMetricGauge(GAUGE_RECORDING, isRecording ? 1 : 0);
 
         // Store frame size on first successful capture
         if (isFirstFrame) {
@@ -279,129 +193,33 @@ int main(int argc, char** argv) {
 
         // Initialize VideoWriter if recording is requested and not yet initialized
         if (isRecording && !videoWriterInitialized) {
-            // Check if we have valid frame dimensions
-            if (frameSize.width > 0 && frameSize.height > 0) {
-                int codec = VideoWriter::fourcc('M', 'J', 'P', 'G');
-                double fps = 30.0; // Target FPS for raw recording
-
-                // Use temp filename for direct recording to file
-                videoWriter.open(tempFilename, codec, fps, frameSize, true);
-
-                if (!videoWriter.isOpened()) {
-                    cerr << "ERROR: Could not open the output video file for write" << endl;
-                    isRecording = false;
-                    setLogMessage("Error");
-                } else {
-                    videoWriterInitialized = true;
-                    cout << "Started recording to " << tempFilename << endl;
-                    setLogMessage("Recording...");
-                }
-            } else {
-                cerr << "ERROR: Invalid frame dimensions: " << frameSize.width << "x" << frameSize.height << endl;
-                isRecording = false;
-                setLogMessage("Error");
-            }
-        }
-
-        // Create a full screen frame from camera input
-        resize(frame, uiFrame, Size(windowWidth, windowHeight));
-
-        // Display date, time and FPS on the video
-        string dateStr = getCurrentDateStr();
-        string timeStr = getCurrentTimeStr();
-        string displayStr = dateStr + " " + timeStr;
-        if (showFPS) {
-            displayStr += " FPS: " + to_string(int(avgFPS));
-        }
-        putText(uiFrame, displayStr, Point(10, 30), FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
-
-        // Show recording indicator in top-right corner if recording
-        if (isRecording) {
-            // Position the recording indicator to avoid conflict with minimize/close buttons
-            int recIndicatorX = minimizeButtonRect.x - 140; // Leave space for text
-            Rect recIndicator(recIndicatorX, 10, 20, 20);
-            circle(uiFrame, Point(recIndicator.x + 10, recIndicator.y + 10), 10, Scalar(0, 0, 255), -1);
-
-            // Show recording time
-            auto currentTime = system_clock::now();
-            duration<double> elapsedSecs = currentTime - recordingStartTime;
-            int mins = static_cast<int>(elapsedSecs.count()) / 60;
-            int secs = static_cast<int>(elapsedSecs.count()) % 60;
-            char timeBuffer[10];
-            sprintf(timeBuffer, "%02d:%02d", mins, secs);
-
-            // Display recording time next to the red dot
-            Point timePos(recIndicator.x + 25, recIndicator.y + 15);
-            putText(uiFrame, timeBuffer, timePos, FONT_HERSHEY_SIMPLEX, UI_FONT_SIZE, Scalar(255, 255, 255), 2);
-        }
-
-        // Draw navigation bar if visible
-        if (showNavBar) {
-            drawNavigationBar(uiFrame, windowWidth, isRecording, isProcessing, isZoomInHeld, isZoomOutHeld);
-        }
-
-        // Update toggle button position and draw it
-        updateToggleButtonPosition(windowWidth);
-
-        if (showNavBar) {
-            // Draw down arrow (to hide navigation bar)
-            downArrowImage.copyTo(uiFrame(toggleNavButtonRect));
-        } else {
-            // Draw up arrow (to show navigation bar)
-            upArrowImage.copyTo(uiFrame(toggleNavButtonRect));
+            videoWriterInitialized = openRecordingWriter();
         }
 
         // Check for held zoom buttons and perform continuous zooming
-        auto currentTime = system_clock::now();
-        duration<double, std::milli> elapsed = currentTime - lastZoomTime;
+        duration<double, std::milli> elapsed = frameCaptureTime - lastZoomTime;
 
-        if ((isZoomInHeld || isZoomOutHeld) && elapsed.count() >= ZOOM_DELAY_MS) {
+        if ((isZoomInHeld || isZoomOutHeld) && !continuousZoom && elapsed.count() >= ZOOM_DELAY_MS) {
             if (isZoomInHeld) {
                 zoomIn();
             }
             else if (isZoomOutHeld) {
                 zoomOut();
             }
-            lastZoomTime = currentTime;
+            lastZoomTime = frameCaptureTime;
         }
 
-        // If recording, write frame directly to temp file
+        // If recording, write frame directly to temp file (before the preview,
+        // so recording keeps its frame budget when the preview is throttled)
         if (isRecording && videoWriterInitialized) {
-            try {
-                // Add overlays to the frame before saving
-                Mat frameWithOverlay = frame.clone();
-
-                // Add date, time and FPS in a single line
-                string dateStr = getCurrentDateStr();
-                string timeStr = getCurrentTimeStr();
-                string displayStr = dateStr + " " + timeStr;
-                if (showFPS) {
-                    displayStr += " FPS: " + to_string(int(avgFPS));
-                }
-
-                putText(frameWithOverlay, displayStr, Point(10, 30),
-                        FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
-
-                videoWriter.write(frameWithOverlay);
-            } catch (const cv::Exception& e) {
-                cerr << "ERROR: Exception while writing video: " << e.what() << endl;
-                videoWriter.release();
-                isRecording = false;
-                videoWriterInitialized = false;
-                setLogMessage("Error");
-            }
+            stageStart = startStage();
+            videoWriterInitialized = writeRecordingFrame(frame, avgFPS);
+            recordStageTime(STAGE_RECORDING, recordLatency(LATENCY_RECORDING, stageStart));
         } else {
             // Reset videoWriterInitialized when not recording
             videoWriterInitialized = false;
         }
-        
-        if (showExportDialog) {
-            drawExportDialog(uiFrame);
-        }
-        
-        // Draw window controls
-        drawWindowControls(uiFrame);
-        
+
         if (useFullscreen) {
             // Enter true fullscreen mode (no window decorations)
             setWindowProperty("Water Dripping Investigation Recording Tools", WND_PROP_FULLSCREEN, WINDOW_FULLSCREEN);
@@ -412,25 +230,94 @@ int main(int argc, char** argv) {
         }
 
         checkDirectorySelection();
-        
-        // Draw background subtraction controls
-        drawBgSubControls(uiFrame, bgSubtractionActive);
-        drawIR(uiFrame, bgSubtractionActive);
 
-        imshow("Water Dripping Investigation Recording Tools", uiFrame);
+        // The preview has the lowest priority: skip it on frames the scheduler sheds
+        if (shouldPresentFrame()) {
+            // Create a full screen frame from the visible part of the camera input
+            stageStart = startStage();
+            renderPreview(frame, uiFrame, Size(windowWidth, windowHeight));
+            recordStageTime(STAGE_PREVIEW, recordLatency(LATENCY_RESIZE, stageStart));
+
+            stageStart = startStage();
+            drawPreviewOverlays(uiFrame, windowWidth, avgFPS);
+            recordStageTime(STAGE_OVERLAY, recordLatency(LATENCY_OVERLAY, stageStart));
+
+            stageStart = startStage();
+            imshow("Water Dripping Investigation Recording Tools", uiFrame);
+            recordStageTime(STAGE_PREVIEW, recordLatency(LATENCY_IMSHOW, stageStart));
+        }
+        endFramePacing();
 
         // Check for key press
+        stageStart = startStage();
         int key = waitKey(1);
+        recordLatency(LATENCY_WAITKEY, stageStart);
         if (key == 27) // ESC key
             break;
         else if (key == 'f' || key == 'F')  // Toggle FPS display
             showFPS = !showFPS;
+        else if (key == 'l' || key == 'L') {  // Toggle latency panel, measuring from now
+            showLatencyPanel = !showLatencyPanel;
+            if (showLatencyPanel) {
+                resetLatencyStats();
+            }
+        }
+        else if (key == 't' || key == 'T') {  // Start tracing, or save the trace and stop
+            if (traceEnabled) {
+                saveTrace();
+                stopTracing();
+            } else {
+                startTracing();
+                setLogMessage("Tracing...");
+            }
+        }
+        else if (key == 'a' || key == 'A') {  // Count allocations per stage, measuring from now
+            if (allocTrackingEnabled) {
+                stopAllocTracking();
+                setLogMessage("Allocation count off");
+            } else {
+                resetLatencyStats();
+                startAllocTracking();
+                setLogMessage("Counting allocations");
+            }
+        }
+        else if (key == 'd' || key == 'D') {  // Dump latency histograms
+            time_t now = time(0);
+            char buffer[80];
+            strftime(buffer, 80, "./latency_%Y%m%d_%H%M%S.txt", localtime(&now));
+            if (dumpLatencyStats(buffer)) {
+                setLogMessage("Latency saved");
+            }
+        }
         else if (key == 'n' || key == 'N')  // Toggle navigation bar
             showNavBar = !showNavBar;
         else if (key == 'b' || key == 'B') {  // Cancel background subtraction
             bgSubtractionActive = false;
             setLogMessage("BG canceled");
         }
+        else if (key == '+' || key == '=')  // Digital zoom in
+            digitalZoomIn();
+        else if (key == '-' || key == '_')  // Digital zoom out
+            digitalZoomOut();
+        else if (key == '0')  // Back to the full frame
+            resetDigitalZoom();
+
+        // Apply mouse input queued during waitKey before the next frame is processed
+        processInputEvents();
+
+        // Apply a reloaded config.ini at the same point
+        appConfig.dispatchChanges();
+
+        // Show what the camera reported back (zoom position, ICR, IR correction)
+        syncCameraStateToUI();
+
+        // Report a finished background export
+        checkExportJob();
+
+        // Trace requested with SIGUSR1
+        if (consumeTraceRequest()) {
+            saveTrace();
+        }
     }
 
     // Clean up
@@ -447,9 +334,18 @@ int main(int argc, char** argv) {
         }
     }
 
-    if (serialInitialized) {
-        cameraSerial.closeDevice();
-    }
+    // Stop an unfinished export, partial copies are removed
+    cancelExportJob();
+
+    // Write out the recordings catalog after the last processing step
+    stopRecordingsCatalog();
+    stopThumbnailJob();
+
+    // Stop the serial worker, it closes the port
+    stopSerialWorker();
+
+    stopConfigWatcher();
+    stopMetricsServer();
 
     cout << "Closing the camera" << endl;
     cap.release();
@@ -0,0 +1,122 @@
+#include "mat_pool.h"
+#include "alloc_stats.h"
+
+// Released buffers kept per size, and in total; beyond either limit a
+// buffer is freed as the standard allocator would
+static const size_t MAX_BUFFERS_PER_SIZE = 8;
+static const size_t MAX_POOLED_BYTES = 64 * 1024 * 1024;
+
+class PooledMatAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                       AccessFlag, UMatUsageFlags) const override {
+        // Same layout as the standard allocator: dense rows unless the caller
+        // passed its own data with explicit steps
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        if (data0) {
+            UMatData* u = new UMatData(this);
+            u->data = u->origdata = static_cast<uchar*>(data0);
+            u->size = total;
+            u->flags |= UMatData::USER_ALLOCATED;
+            return u;
+        }
+
+        {
+            lock_guard<mutex> lock(poolMutex);
+            auto it = freeBuffers.find(total);
+            if (it != freeBuffers.end() && !it->second.empty()) {
+                // A released buffer keeps its UMatData; only the flags need resetting
+                UMatData* u = it->second.back();
+                it->second.pop_back();
+                pooledBuffers--;
+                pooledBytes -= total;
+                hits++;
+                u->flags = UMatData::MemoryFlag(0);
+                return u;
+            }
+            misses++;
+        }
+
+        uchar* data = static_cast<uchar*>(fastMalloc(total));
+        countHeapAllocation(total);
+        UMatData* u = new UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        return u;
+    }
+
+    bool allocate(UMatData* u, AccessFlag, UMatUsageFlags) const override {
+        return u != nullptr;
+    }
+
+    void deallocate(UMatData* u) const override {
+        if (!u) {
+            return;
+        }
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        if (!(u->flags & UMatData::USER_ALLOCATED)) {
+            lock_guard<mutex> lock(poolMutex);
+            if (pooledBytes + u->size <= MAX_POOLED_BYTES) {
+                vector<UMatData*>& buffers = freeBuffers[u->size];
+                if (buffers.size() < MAX_BUFFERS_PER_SIZE) {
+                    buffers.reserve(MAX_BUFFERS_PER_SIZE);
+                    buffers.push_back(u);
+                    pooledBuffers++;
+                    pooledBytes += u->size;
+                    return;
+                }
+            }
+            fastFree(u->origdata);
+            u->origdata = nullptr;
+        }
+        delete u;
+    }
+
+    MatPoolStats stats() const {
+        lock_guard<mutex> lock(poolMutex);
+        return MatPoolStats{hits, misses, pooledBuffers, pooledBytes};
+    }
+
+private:
+    mutable mutex poolMutex;
+    mutable map<size_t, vector<UMatData*>> freeBuffers;
+    mutable size_t pooledBuffers = 0;
+    mutable size_t pooledBytes = 0;
+    mutable uint64_t hits = 0;
+    mutable uint64_t misses = 0;
+};
+
+// Never destroyed: Mats released during static destruction still return here
+static PooledMatAllocator* matPool = nullptr;
+static once_flag matPoolInstalled;
+
+void installMatPool() {
+    call_once(matPoolInstalled, [] {
+        matPool = new PooledMatAllocator();
+        Mat::setDefaultAllocator(matPool);
+    });
+}
+
+bool isMatPoolInstalled() {
+    return matPool != nullptr;
+}
+
+MatPoolStats getMatPoolStats() {
+    if (!matPool) {
+        return MatPoolStats{0, 0, 0, 0};
+    }
+    return matPool->stats();
+}
@@ -0,0 +1,24 @@
+#ifndef MAT_POOL_H
+#define MAT_POOL_H
+
+#include "common.h"
+
+// Default Mat allocator that keeps released buffers and hands them out again
+// for the next Mat of the same byte size. The frame loop uses the same few
+// sizes every frame, so once each has been seen it stops reaching malloc.
+// Installed at startup unless MAT_POOL is off; Mats created before keep the
+// standard allocator.
+void installMatPool();
+
+bool isMatPoolInstalled();
+
+struct MatPoolStats {
+    uint64_t hits;          // allocations served from the pool
+    uint64_t misses;        // allocations that went to fastMalloc
+    size_t pooledBuffers;   // released buffers currently held
+    size_t pooledBytes;
+};
+
+MatPoolStats getMatPoolStats();
+
+#endif // MAT_POOL_H
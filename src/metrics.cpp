@@ -0,0 +1,298 @@
+#include "metrics.h"
+#include "latency_stats.h"
+#include "recordings_catalog.h"
+#include "trace.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/statvfs.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Requests larger than this are not a scrape
+static const size_t MAX_REQUEST_SIZE = 8192;
+
+// Connections that never finish their request are closed
+static const int CONNECTION_TIMEOUT_MS = 5000;
+
+static const int MAX_EVENTS = 16;
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+};
+
+static const MetricInfo COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    {"drip_frames_captured_total", "Frames read from the camera"},
+    {"drip_frames_dropped_total", "Camera frames missed between two reads"},
+    {"drip_frames_recorded_total", "Frames written to the recording"},
+    {"drip_recording_errors_total", "Failed recording writes"},
+    {"drip_detections_total", "New drop points detected"},
+    {"drip_serial_commands_total", "VISCA commands sent to the camera"},
+    {"drip_serial_errors_total", "VISCA error replies, timeouts and lost serial ports"},
+};
+
+static const MetricInfo GAUGE_INFO[GAUGE_COUNT] = {
+    {"drip_capture_fps", "Frames captured per second, averaged over the last frames"},
+    {"drip_preview_fps", "Preview rate chosen by the frame pacer"},
+    {"drip_recording", "1 while recording"},
+    {"drip_serial_queue_depth", "VISCA commands waiting to be sent"},
+};
+
+struct MetricsConnection {
+    string request;
+    string response;
+    size_t sent = 0;
+    steady_clock::time_point openedAt;
+};
+
+static thread metricsThread;
+static atomic<bool> metricsRunning(false);
+static int metricsListenFd = -1;
+static int metricsEpollFd = -1;
+static int metricsWakeFd = -1;
+
+string formatMetrics() {
+    std::ostringstream out;
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        out << "# HELP " << COUNTER_INFO[i].name << ' ' << COUNTER_INFO[i].help << '\n'
+            << "# TYPE " << COUNTER_INFO[i].name << " counter\n"
+            << COUNTER_INFO[i].name << ' ' << metricCounters[i].load(memory_order_relaxed) << '\n';
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        out << "# HELP " << GAUGE_INFO[i].name << ' ' << GAUGE_INFO[i].help << '\n'
+            << "# TYPE " << GAUGE_INFO[i].name << " gauge\n"
+            << GAUGE_INFO[i].name << ' ' << metricGauges[i].load(memory_order_relaxed) << '\n';
+    }
+
+    // Read at scrape time, nothing to update on the hot path
+    struct statvfs disk;
+    if (statvfs(RECORDINGS_DIR, &disk) == 0) {
+        out << "# HELP drip_disk_free_bytes Free space for recordings\n"
+            << "# TYPE drip_disk_free_bytes gauge\n"
+            << "drip_disk_free_bytes " << uint64_t(disk.f_bavail) * disk.f_frsize << '\n';
+    }
+
+    // The per-stage latency histograms, as a summary
+    out << "# HELP drip_stage_latency_seconds Main loop stage durations\n"
+        << "# TYPE drip_stage_latency_seconds summary\n";
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        LatencySummary summary = getLatencySummary(LatencyStage(stage));
+        string labels = string("{stage=\"") + latencyStageName(LatencyStage(stage)) + "\"";
+        out << "drip_stage_latency_seconds" << labels << ",quantile=\"0.5\"} " << summary.p50Ms / 1000 << '\n'
+            << "drip_stage_latency_seconds" << labels << ",quantile=\"0.95\"} " << summary.p95Ms / 1000 << '\n'
+            << "drip_stage_latency_seconds" << labels << ",quantile=\"0.99\"} " << summary.p99Ms / 1000 << '\n'
+            << "drip_stage_latency_seconds_sum" << labels << "} " << summary.meanMs * summary.count / 1000 << '\n'
+            << "drip_stage_latency_seconds_count" << labels << "} " << summary.count << '\n';
+    }
+
+    // Heap allocations per frame, only while allocation tracking is on
+    if (allocTrackingEnabled.load(memory_order_relaxed)) {
+        LatencySummary summaries[LATENCY_STAGE_COUNT];
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            summaries[stage] = getLatencySummary(LatencyStage(stage));
+        }
+        out << "# HELP drip_stage_allocations_per_frame Heap allocations per frame by main loop stage\n"
+            << "# TYPE drip_stage_allocations_per_frame gauge\n";
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            out << "drip_stage_allocations_per_frame{stage=\"" << latencyStageName(LatencyStage(stage))
+                << "\"} " << summaries[stage].allocationsPerFrame << '\n';
+        }
+        out << "# HELP drip_stage_allocated_bytes_per_frame Heap bytes allocated per frame by main loop stage\n"
+            << "# TYPE drip_stage_allocated_bytes_per_frame gauge\n";
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            out << "drip_stage_allocated_bytes_per_frame{stage=\"" << latencyStageName(LatencyStage(stage))
+                << "\"} " << summaries[stage].bytesPerFrame << '\n';
+        }
+    }
+    return out.str();
+}
+
+static void closeConnection(map<int, MetricsConnection>& connections, int fd) {
+    epoll_ctl(metricsEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+static string httpResponse(const char* status, const string& contentType, const string& body) {
+    return string("HTTP/1.1 ") + status + "\r\n"
+           "Content-Type: " + contentType + "\r\n"
+           "Content-Length: " + to_string(body.size()) + "\r\n"
+           "Connection: close\r\n\r\n" + body;
+}
+
+// Build the response once the request line and headers are in
+static bool parseRequest(MetricsConnection& connection) {
+    if (connection.request.find("\r\n\r\n") == string::npos &&
+        connection.request.find("\n\n") == string::npos) {
+        return false;
+    }
+    if (connection.request.compare(0, 13, "GET /metrics ") == 0 ||
+        connection.request.compare(0, 14, "GET /metrics?") == 0) {
+        connection.response = httpResponse("200 OK", "text/plain; version=0.0.4", formatMetrics());
+    } else if (connection.request.compare(0, 4, "GET ") == 0) {
+        connection.response = httpResponse("404 Not Found", "text/plain", "Not found\n");
+    } else {
+        connection.response = httpResponse("405 Method Not Allowed", "text/plain", "Only GET\n");
+    }
+    return true;
+}
+
+// Send as much as the socket takes, returns true when the connection is done
+static bool flushResponse(MetricsConnection& connection, int fd) {
+    while (connection.sent < connection.response.size()) {
+        ssize_t count = send(fd, connection.response.data() + connection.sent,
+                             connection.response.size() - connection.sent, MSG_NOSIGNAL);
+        if (count < 0) {
+            return errno != EAGAIN && errno != EWOULDBLOCK;
+        }
+        connection.sent += count;
+    }
+    return true;
+}
+
+static void acceptConnections(map<int, MetricsConnection>& connections) {
+    while (true) {
+        int fd = accept4(metricsListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(metricsEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        connections[fd].openedAt = steady_clock::now();
+    }
+}
+
+static void handleConnection(map<int, MetricsConnection>& connections, int fd, uint32_t events) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+        return;
+    }
+    MetricsConnection& connection = it->second;
+
+    if (connection.response.empty() && (events & EPOLLIN)) {
+        char buffer[1024];
+        ssize_t count;
+        while ((count = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            connection.request.append(buffer, count);
+        }
+        if (connection.request.size() > MAX_REQUEST_SIZE || count == 0 ||
+            (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            if (!parseRequest(connection)) {
+                closeConnection(connections, fd);
+                return;
+            }
+        } else if (!parseRequest(connection)) {
+            return;
+        }
+    } else if (events & (EPOLLERR | EPOLLHUP)) {
+        closeConnection(connections, fd);
+        return;
+    }
+
+    if (!connection.response.empty()) {
+        if (flushResponse(connection, fd)) {
+            closeConnection(connections, fd);
+            return;
+        }
+        // The rest goes out when the socket drains
+        struct epoll_event event = {};
+        event.events = EPOLLOUT;
+        event.data.fd = fd;
+        epoll_ctl(metricsEpollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+}
+
+static void runMetricsServer() {
+    setTraceThreadName("metrics");
+    map<int, MetricsConnection> connections;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (metricsRunning) {
+        int count = epoll_wait(metricsEpollFd, events, MAX_EVENTS, CONNECTION_TIMEOUT_MS);
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == metricsWakeFd) {
+                continue;
+            } else if (fd == metricsListenFd) {
+                acceptConnections(connections);
+            } else {
+                handleConnection(connections, fd, events[i].events);
+            }
+        }
+
+        steady_clock::time_point now = steady_clock::now();
+        for (auto it = connections.begin(); it != connections.end(); ) {
+            auto current = it++;
+            if (now - current->second.openedAt >= milliseconds(CONNECTION_TIMEOUT_MS)) {
+                closeConnection(connections, current->first);
+            }
+        }
+    }
+
+    for (auto& connection : connections) {
+        close(connection.first);
+    }
+}
+
+bool startMetricsServer(int port) {
+    if (metricsRunning) {
+        return true;
+    }
+
+    // Local only: the fleet scraper reaches it through an agent or SSH tunnel
+    metricsListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(metricsListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (metricsListenFd < 0 ||
+        ::bind(metricsListenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(metricsListenFd, 16) != 0) {
+        cerr << "Failed to listen for metrics on port " << port << ": " << strerror(errno) << endl;
+        if (metricsListenFd >= 0) {
+            close(metricsListenFd);
+            metricsListenFd = -1;
+        }
+        return false;
+    }
+
+    metricsEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    metricsWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = metricsListenFd;
+    epoll_ctl(metricsEpollFd, EPOLL_CTL_ADD, metricsListenFd, &event);
+    event.data.fd = metricsWakeFd;
+    epoll_ctl(metricsEpollFd, EPOLL_CTL_ADD, metricsWakeFd, &event);
+
+    metricsRunning = true;
+    metricsThread = thread(runMetricsServer);
+    cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << endl;
+    return true;
+}
+
+void stopMetricsServer() {
+    if (!metricsRunning) {
+        return;
+    }
+    metricsRunning = false;
+    uint64_t one = 1;
+    if (write(metricsWakeFd, &one, sizeof(one)) < 0) {
+        cerr << "Failed to wake the metrics server" << endl;
+    }
+    if (metricsThread.joinable()) {
+        metricsThread.join();
+    }
+    close(metricsListenFd);
+    close(metricsEpollFd);
+    close(metricsWakeFd);
+    metricsListenFd = metricsEpollFd = metricsWakeFd = -1;
+}
@@ -0,0 +1,47 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+// Counters exported on /metrics. Each one has a single writer thread, so an
+// update is a relaxed load and store: wait-free, no read-modify-write.
+enum MetricCounter {
+    METRIC_FRAMES_CAPTURED = 0,
+    METRIC_FRAMES_DROPPED,      // camera frames missed between two reads
+    METRIC_FRAMES_RECORDED,
+    METRIC_RECORDING_ERRORS,
+    METRIC_DETECTIONS,
+    METRIC_SERIAL_COMMANDS,
+    METRIC_SERIAL_ERRORS,       // error replies, timeouts and lost ports
+    METRIC_COUNTER_COUNT
+};
+
+// Current values, written by one thread and read by the metrics server
+enum MetricGauge {
+    GAUGE_CAPTURE_FPS = 0,
+    GAUGE_PREVIEW_FPS,
+    GAUGE_RECORDING,
+    GAUGE_SERIAL_QUEUE_DEPTH,
+    GAUGE_COUNT
+};
+
+inline atomic<uint64_t> metricCounters[METRIC_COUNTER_COUNT];
+inline atomic<double> metricGauges[GAUGE_COUNT];
+
+inline void countMetric(MetricCounter counter, uint64_t amount = 1) {
+    atomic<uint64_t>& value = metricCounters[counter];
+    value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+inline void setMetricGauge(MetricGauge gauge, double value) {
+    metricGauges[gauge].store(value, memory_order_relaxed);
+}
+
+// Serve /metrics in Prometheus text format on 127.0.0.1:port (one thread, epoll)
+bool startMetricsServer(int port);
+void stopMetricsServer();
+
+// The page served on /metrics
+string formatMetrics();
+
+#endif // METRICS_H
@@ -1,5 +1,8 @@
 #include "navigation_bar.h"
 #include "ui_helpers.h"
+#include "digital_zoom.h"
+#include "frame_pacing.h"
+#include "export_job.h"
 
 void initNavigationBar(int windowWidth, int windowHeight) {
     // Bottom navigation bar (full width, 80px height at bottom)
@@ -42,12 +45,21 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
         return;
     }
     
-    // Create semi-transparent navigation bar at the bottom
-    Mat bottomBar = img(navBarRect).clone();
-    Mat overlay(bottomBar.rows, bottomBar.cols, bottomBar.type(), Scalar(20, 60, 20));
-    double alpha = 0.7; // Transparency level (0.0 = fully transparent, 1.0 = opaque)
-    addWeighted(overlay, alpha, bottomBar, 1.0 - alpha, 0.0, bottomBar);
-    bottomBar.copyTo(img(navBarRect));
+    if (isOverlayReduced()) {
+        // Under load, draw a solid bar instead of blending
+        rectangle(img, navBarRect, Scalar(20, 60, 20), -1);
+    } else {
+        // Create semi-transparent navigation bar at the bottom, blended in
+        // place; the fill is only rebuilt when the bar changes size
+        static Mat overlay;
+        Mat bottomBar = img(navBarRect);
+        if (overlay.size() != bottomBar.size() || overlay.type() != bottomBar.type()) {
+            overlay.create(bottomBar.size(), bottomBar.type());
+            overlay.setTo(Scalar(20, 60, 20));
+        }
+        double alpha = 0.7; // Transparency level (0.0 = fully transparent, 1.0 = opaque)
+        addWeighted(overlay, alpha, bottomBar, 1.0 - alpha, 0.0, bottomBar);
+    }
 
     // Draw record/stop button
     rectangle(img, recordButtonRect, isRecording ? Scalar(60, 0, 0) : BUTTON_COLOR, -1);
@@ -57,7 +69,7 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
 
     // Export button
-    Scalar exportBtnColor = isProcessing ? Scalar(30, 30, 30) : BUTTON_COLOR;
+    Scalar exportBtnColor = (isProcessing || isExportRunning()) ? Scalar(30, 30, 30) : BUTTON_COLOR;
     rectangle(img, exportButtonRect, exportBtnColor, -1);
     rectangle(img, exportButtonRect, Scalar(100, 100, 100), 1);
     putText(img, "Export", 
@@ -78,15 +90,18 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
             Point(zoomOutButtonRect.x + 10, zoomOutButtonRect.y + zoomOutButtonRect.height/2 + 5),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
 
+    // Pan buttons only do something while digitally zoomed in
+    Scalar panBtnColor = isDigitalZoomActive() ? BUTTON_COLOR : Scalar(100, 100, 100);
+
     // Pan Up button
-    rectangle(img, panUpButtonRect, BUTTON_COLOR, -1);
+    rectangle(img, panUpButtonRect, panBtnColor, -1);
     rectangle(img, panUpButtonRect, Scalar(100, 150, 100), 1);
     putText(img, "Pan Up", 
             Point(panUpButtonRect.x + 10, panUpButtonRect.y + panUpButtonRect.height/2 + 5),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
 
     // Pan Down button
-    rectangle(img, panDownButtonRect, BUTTON_COLOR, -1);
+    rectangle(img, panDownButtonRect, panBtnColor, -1);
     rectangle(img, panDownButtonRect, Scalar(100, 150, 100), 1);
     putText(img, "Pan Down", 
             Point(panDownButtonRect.x + 10, panDownButtonRect.y + panDownButtonRect.height/2 + 5),
@@ -97,6 +112,16 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
     Rect statusRect(statusX, navBarRect.y + 10, windowWidth - statusX - PADDING, panDownButtonRect.height);
     rectangle(img, statusRect, Scalar(40, 40, 40), -1);
 
+    // Camera connection indicator at the right end of the status area
+    circle(img, Point(statusRect.x + statusRect.width - 15, statusRect.y + statusRect.height/2), 6,
+           serialInitialized ? Scalar(0, 200, 0) : Scalar(0, 0, 200), -1);
+
+    // Export progress along the bottom of the status area
+    if (isExportRunning()) {
+        drawProgressBar(img, Rect(statusRect.x, statusRect.y + statusRect.height - 6, statusRect.width, 6),
+                        progressValue, progressMax, PROGRESS_BAR_COLOR);
+    }
+
     // Show status/log message
     putText(img, getLogMessage(), 
             Point(statusRect.x + 10, statusRect.y + statusRect.height/2 + 5),
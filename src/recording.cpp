@@ -1,11 +1,17 @@
 #include "recording.h"
+#include "recordings_catalog.h"
+#include "trace.h"
 #include <cstdio>
 #include <fstream>
 #include <filesystem>
 
 // In recording.cpp, modify the postProcessVideo function:
 
-void postProcessVideo(const string& inputFilename, double recordingDurationSeconds) {
+void postProcessVideo(const string& inputFilename, double recordingDurationSeconds,
+                      int detectionEvents) {
+    setTraceThreadName("postprocess");
+    TRACE_SCOPE("postprocess");
+
     // Check if input file exists
     if (access(inputFilename.c_str(), F_OK) != 0) {
         cerr << "ERROR: Input file does not exist: " << inputFilename << endl;
@@ -15,16 +21,18 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
     }
 
     // Generate output filename
-    string outputFilename = "./recordings/" + inputFilename.substr(5, 14) + ".avi";
+    string outputName = inputFilename.substr(5, 14) + ".avi";
+    string outputFilename = RECORDINGS_DIR + outputName;
     
     // Create directory if it doesn't exist
-    filesystem::create_directories("./recordings/");
+    filesystem::create_directories(RECORDINGS_DIR);
     
     // Get frame count using FFmpeg
     string frameCountCmd = "ffprobe -v error -count_frames -select_streams v:0 "
                          "-show_entries stream=nb_read_frames -of default=nokey=1:noprint_wrappers=1 "
                          "\"" + inputFilename + "\"";
     
+    steady_clock::time_point probeStart = steady_clock::now();
     FILE* fpipeCount = popen(frameCountCmd.c_str(), "r");
     if (!fpipeCount) {
         cerr << "Error running FFprobe for frame count" << endl;
@@ -39,6 +47,9 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
         frameCountStr += buffer;
     }
     pclose(fpipeCount);
+    if (traceEnabled.load(memory_order_relaxed)) {
+        traceEvent("ffprobe frame count", probeStart, steady_clock::now());
+    }
     
     // Remove trailing newline
     frameCountStr.erase(std::remove(frameCountStr.begin(), frameCountStr.end(), '\n'), 
@@ -75,6 +86,7 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
     cout << "FFmpeg command: " << command << endl;
     
     // Start FFmpeg process
+    TRACE_SCOPE("ffmpeg remux");
     FILE* pipe = popen(command.c_str(), "r");
     
     if (!pipe) {
@@ -141,6 +153,15 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
             // Success
             progressValue = 100;
             setLogMessage("Saved to file");
+
+            // Metadata known now, so the export dialog never has to probe the file
+            RecordingInfo info;
+            info.name = outputName;
+            info.frameCount = totalFrames;
+            info.durationSeconds = recordingDurationSeconds;
+            info.fps = exactFPS;
+            info.detectionEvents = detectionEvents;
+            addRecordingToCatalog(info);
             
             // Remove the temporary files
             remove(inputFilename.c_str());
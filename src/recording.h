@@ -3,7 +3,8 @@
 
 #include "common.h"
 
-// Function to post-process video to match actual FPS
-void postProcessVideo(const string& inputFilename, double actualFPS);
+// Function to post-process video to match actual FPS, then add it to the recordings catalog
+void postProcessVideo(const string& inputFilename, double recordingDurationSeconds,
+                      int detectionEvents);
 
 #endif // RECORDING_H
@@ -0,0 +1,320 @@
+#include "recordings_catalog.h"
+#include "thumbnail_job.h"
+#include "trace.h"
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <dirent.h>
+#include <set>
+
+const char* RECORDINGS_DIR = "./recordings/";
+
+// Index file inside the recordings directory, one tab-separated line per recording
+static const char* CATALOG_NAME = ".catalog";
+
+// Changes are written out once the directory has been quiet for this long
+static const int SAVE_DELAY_MS = 500;
+
+// How often the watcher checks for a stop request
+static const int POLL_INTERVAL_MS = 500;
+
+static map<string, RecordingInfo> catalog;
+static mutex catalogMutex;
+static bool catalogDirty = false;
+static steady_clock::time_point catalogChangedAt;
+
+static thread catalogThread;
+static atomic<bool> catalogRunning(false);
+static int catalogInotifyFd = -1;
+
+static string catalogPath() {
+    return string(RECORDINGS_DIR) + CATALOG_NAME;
+}
+
+static bool isRecordingFile(const string& name) {
+    auto endsWith = [&name](const char* suffix) {
+        size_t length = strlen(suffix);
+        return name.size() > length && name.compare(name.size() - length, length, suffix) == 0;
+    };
+    return name[0] != '.' && (endsWith(".avi") || endsWith(".mp4"));
+}
+
+static void markDirty() {
+    catalogDirty = true;
+    catalogChangedAt = steady_clock::now();
+}
+
+static void loadCatalog() {
+    ifstream file(catalogPath());
+    string line;
+    while (getline(file, line)) {
+        istringstream fields(line);
+        RecordingInfo info;
+        if (getline(fields, info.name, '\t') &&
+            fields >> info.sizeBytes >> info.modifiedTime >> info.frameCount
+                   >> info.durationSeconds >> info.fps >> info.detectionEvents) {
+            if (!(fields >> info.thumbnail) || info.thumbnail == "-") {
+                info.thumbnail.clear();
+            }
+            catalog[info.name] = info;
+        }
+    }
+}
+
+static void saveCatalog() {
+    vector<RecordingInfo> entries;
+    {
+        lock_guard<mutex> lock(catalogMutex);
+        if (!catalogDirty) {
+            return;
+        }
+        catalogDirty = false;
+        for (const auto& entry : catalog) {
+            entries.push_back(entry.second);
+        }
+    }
+
+    // Write a new file and rename it, so a crash never leaves half a catalog
+    TRACE_SCOPE("catalog save");
+    string tempPath = catalogPath() + ".tmp";
+    {
+        ofstream file(tempPath);
+        if (!file.is_open()) {
+            cerr << "Failed to write recordings catalog " << tempPath << endl;
+            return;
+        }
+        for (const RecordingInfo& info : entries) {
+            file << info.name << '\t' << info.sizeBytes << ' ' << info.modifiedTime << ' '
+                 << info.frameCount << ' ' << info.durationSeconds << ' ' << info.fps << ' '
+                 << info.detectionEvents << ' '
+                 << (info.thumbnail.empty() ? "-" : info.thumbnail) << '\n';
+        }
+    }
+    if (rename(tempPath.c_str(), catalogPath().c_str()) != 0) {
+        cerr << "Failed to update recordings catalog: " << strerror(errno) << endl;
+    }
+}
+
+// A file appeared or changed: keep known metadata if it is still the same file
+static void updateFromFile(const string& name) {
+    struct stat fileStat;
+    if (stat((string(RECORDINGS_DIR) + name).c_str(), &fileStat) != 0) {
+        return;
+    }
+    lock_guard<mutex> lock(catalogMutex);
+    auto it = catalog.find(name);
+    if (it != catalog.end() && it->second.sizeBytes == fileStat.st_size &&
+        it->second.modifiedTime == fileStat.st_mtime) {
+        return;
+    }
+    RecordingInfo info;
+    info.name = name;
+    info.sizeBytes = fileStat.st_size;
+    info.modifiedTime = fileStat.st_mtime;
+    catalog[name] = info;
+    markDirty();
+    queueThumbnail(name);
+}
+
+static void removeThumbnail(const RecordingInfo& info) {
+    if (!info.thumbnail.empty()) {
+        remove((string(RECORDINGS_DIR) + info.thumbnail).c_str());
+    }
+}
+
+static void removeFile(const string& name) {
+    lock_guard<mutex> lock(catalogMutex);
+    auto it = catalog.find(name);
+    if (it != catalog.end()) {
+        removeThumbnail(it->second);
+        catalog.erase(it);
+        markDirty();
+    }
+}
+
+// Bring the catalog in line with files changed while the application was not running
+static void reconcileCatalog() {
+    set<string> present;
+    DIR* dir = opendir(RECORDINGS_DIR);
+    if (dir) {
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != NULL) {
+            string name = ent->d_name;
+            if (isRecordingFile(name)) {
+                present.insert(name);
+                updateFromFile(name);
+            }
+        }
+        closedir(dir);
+    }
+
+    lock_guard<mutex> lock(catalogMutex);
+    for (auto it = catalog.begin(); it != catalog.end(); ) {
+        if (present.count(it->first) == 0) {
+            removeThumbnail(it->second);
+            it = catalog.erase(it);
+            markDirty();
+            continue;
+        }
+        // Previews that were never built or have been deleted since
+        RecordingInfo& info = it->second;
+        if (!info.thumbnail.empty() && access((string(RECORDINGS_DIR) + info.thumbnail).c_str(), F_OK) != 0) {
+            info.thumbnail.clear();
+            markDirty();
+        }
+        if (info.thumbnail.empty()) {
+            queueThumbnail(info.name);
+        }
+        ++it;
+    }
+}
+
+static void watchRecordings() {
+    setTraceThreadName("catalog");
+    reconcileCatalog();
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (catalogRunning) {
+        bool dirty;
+        steady_clock::time_point changedAt;
+        {
+            lock_guard<mutex> lock(catalogMutex);
+            dirty = catalogDirty;
+            changedAt = catalogChangedAt;
+        }
+
+        struct pollfd pfd = {catalogInotifyFd, POLLIN, 0};
+        int ready = poll(&pfd, 1, dirty ? SAVE_DELAY_MS : POLL_INTERVAL_MS);
+
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            ssize_t len = read(catalogInotifyFd, buffer, sizeof(buffer));
+            for (char* ptr = buffer; len > 0 && ptr < buffer + len; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                if (event->len > 0 && isRecordingFile(event->name)) {
+                    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                        updateFromFile(event->name);
+                    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        removeFile(event->name);
+                    }
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+
+        if (dirty && steady_clock::now() - changedAt >= milliseconds(SAVE_DELAY_MS)) {
+            saveCatalog();
+        }
+    }
+    saveCatalog();
+}
+
+void startRecordingsCatalog() {
+    if (catalogRunning) {
+        return;
+    }
+    filesystem::create_directories(RECORDINGS_DIR);
+    {
+        lock_guard<mutex> lock(catalogMutex);
+        loadCatalog();
+    }
+
+    catalogInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (catalogInotifyFd < 0 ||
+        inotify_add_watch(catalogInotifyFd, RECORDINGS_DIR,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0) {
+        cerr << "Failed to watch " << RECORDINGS_DIR << ", recordings list may be stale" << endl;
+        if (catalogInotifyFd >= 0) {
+            close(catalogInotifyFd);
+            catalogInotifyFd = -1;
+        }
+        reconcileCatalog();
+        saveCatalog();
+        return;
+    }
+
+    catalogRunning = true;
+    catalogThread = thread(watchRecordings);
+}
+
+void stopRecordingsCatalog() {
+    if (!catalogRunning) {
+        return;
+    }
+    catalogRunning = false;
+    if (catalogThread.joinable()) {
+        catalogThread.join();
+    }
+    close(catalogInotifyFd);
+    catalogInotifyFd = -1;
+}
+
+void addRecordingToCatalog(const RecordingInfo& info) {
+    RecordingInfo entry = info;
+    struct stat fileStat;
+    if (stat((string(RECORDINGS_DIR) + info.name).c_str(), &fileStat) == 0) {
+        entry.sizeBytes = fileStat.st_size;
+        entry.modifiedTime = fileStat.st_mtime;
+    }
+    {
+        lock_guard<mutex> lock(catalogMutex);
+        // The watcher may have seen the file first and already queued its preview
+        auto it = catalog.find(entry.name);
+        if (it != catalog.end() && entry.thumbnail.empty()) {
+            entry.thumbnail = it->second.thumbnail;
+        }
+        catalog[entry.name] = entry;
+        markDirty();
+        if (entry.thumbnail.empty()) {
+            queueThumbnail(entry.name);
+        }
+    }
+    if (!catalogRunning) {
+        saveCatalog();
+    }
+}
+
+void setRecordingThumbnail(const string& name, const string& thumbnail) {
+    {
+        lock_guard<mutex> lock(catalogMutex);
+        auto it = catalog.find(name);
+        if (it == catalog.end()) {
+            // Deleted while its preview was being built
+            remove((string(RECORDINGS_DIR) + thumbnail).c_str());
+            return;
+        }
+        it->second.thumbnail = thumbnail;
+        markDirty();
+    }
+    if (!catalogRunning) {
+        saveCatalog();
+    }
+}
+
+vector<RecordingInfo> getRecordingsCatalog() {
+    lock_guard<mutex> lock(catalogMutex);
+    vector<RecordingInfo> entries;
+    entries.reserve(catalog.size());
+    for (const auto& entry : catalog) {
+        entries.push_back(entry.second);
+    }
+    return entries;
+}
+
+string formatRecordingInfo(const RecordingInfo& info) {
+    std::stringstream stream;
+    if (info.frameCount >= 0) {
+        int seconds = int(info.durationSeconds + 0.5);
+        stream << setfill('0') << setw(2) << seconds / 60 << ":" << setw(2) << seconds % 60
+               << setfill(' ') << "  " << fixed << setprecision(1) << info.fps << " fps  ";
+    }
+    double megabytes = info.sizeBytes / (1024.0 * 1024.0);
+    if (megabytes >= 1024) {
+        stream << fixed << setprecision(1) << megabytes / 1024 << " GB";
+    } else {
+        stream << fixed << setprecision(megabytes < 10 ? 1 : 0) << megabytes << " MB";
+    }
+    if (info.detectionEvents >= 0) {
+        stream << "  " << info.detectionEvents << " drops";
+    }
+    return stream.str();
+}
@@ -0,0 +1,37 @@
+#ifndef RECORDINGS_CATALOG_H
+#define RECORDINGS_CATALOG_H
+
+#include "common.h"
+
+// Directory finished recordings are written to
+extern const char* RECORDINGS_DIR;
+
+// What is known about a recording without opening it
+struct RecordingInfo {
+    string name;
+    long long sizeBytes = 0;
+    long long modifiedTime = 0;     // seconds since the epoch
+    int frameCount = -1;            // -1 if the file was not recorded here
+    double durationSeconds = 0;
+    double fps = 0;
+    int detectionEvents = -1;       // drop points found while recording, -1 if unknown
+    string thumbnail;               // preview strip relative to RECORDINGS_DIR, empty until built
+};
+
+// Load the catalog and keep it current with inotify on the recordings directory
+void startRecordingsCatalog();
+void stopRecordingsCatalog();
+
+// Record the metadata of a recording that was just finalized
+void addRecordingToCatalog(const RecordingInfo& info);
+
+// Attach a preview strip built by the thumbnail job
+void setRecordingThumbnail(const string& name, const string& thumbnail);
+
+// All recordings, sorted by name (a copy, safe from any thread)
+vector<RecordingInfo> getRecordingsCatalog();
+
+// "mm:ss  30.0 fps  1.2 GB  5 drops" for the export dialog
+string formatRecordingInfo(const RecordingInfo& info);
+
+#endif // RECORDINGS_CATALOG_H
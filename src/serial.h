@@ -6,19 +6,23 @@
 
 extern serialib cameraSerial;
 
-// Initialize serial connection
+// Initialize serial connection (called by the serial worker thread)
 bool initializeSerial();
 
-// Send zoom command
-void sendZoomCommand(int level);
+// Device the camera was last connected on
+std::string getSerialPortName();
 
-// Function to convert decimal to hex string
-std::string decToHex(int decimalNumber);
+// Queue zoom command
+void sendZoomCommand(int level);
 
 // Zoom functions
 void zoomIn();
 void zoomOut();
 void sendICRCommand(bool enable);
+
+// Continuous zoom: start on press, stop (and read back the position) on release
+void startContinuousZoom(bool tele);
+void stopContinuousZoom();
 void sendIRCorrectionCommand(bool enable);
 
 #endif // SERIAL_H
@@ -0,0 +1,124 @@
+#include "serial_discovery.h"
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+static const char* SYS_CLASS_TTY = "/sys/class/tty";
+
+// First line of a sysfs attribute, empty if it does not exist
+static string readSysfsValue(const filesystem::path& path) {
+    ifstream file(path);
+    string value;
+    getline(file, value);
+    return value;
+}
+
+// "vvvv:pppp" of the USB device a tty belongs to, empty for non-USB ttys
+static string usbIdOf(const string& ttyName) {
+    error_code error;
+    filesystem::path device = filesystem::canonical(filesystem::path(SYS_CLASS_TTY) / ttyName / "device", error);
+    if (error) {
+        return "";
+    }
+    // The tty hangs off a USB interface; idVendor/idProduct live on the device above it
+    for (filesystem::path dir = device; dir.has_relative_path(); dir = dir.parent_path()) {
+        string vendor = readSysfsValue(dir / "idVendor");
+        string product = readSysfsValue(dir / "idProduct");
+        if (!vendor.empty() && !product.empty()) {
+            return vendor + ":" + product;
+        }
+    }
+    return "";
+}
+
+vector<string> findSerialPorts(const string& preferredPort, const string& usbId) {
+    vector<string> matching;
+    vector<string> usbPorts;
+    vector<string> acmPorts;
+
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(SYS_CLASS_TTY, error)) {
+        string name = entry.path().filename().string();
+        bool isUsb = name.rfind("ttyUSB", 0) == 0;
+        bool isAcm = name.rfind("ttyACM", 0) == 0;
+        if (!isUsb && !isAcm) {
+            continue;
+        }
+        string port = "/dev/" + name;
+        if (!usbId.empty() && usbIdOf(name) == usbId) {
+            matching.push_back(port);
+        } else if (isUsb) {
+            usbPorts.push_back(port);
+        } else {
+            acmPorts.push_back(port);
+        }
+    }
+    sort(matching.begin(), matching.end());
+    sort(usbPorts.begin(), usbPorts.end());
+    sort(acmPorts.begin(), acmPorts.end());
+
+    vector<string> ports;
+    if (!preferredPort.empty()) {
+        ports.push_back(preferredPort);
+    }
+    for (const vector<string>* group : {&matching, &usbPorts, &acmPorts}) {
+        for (const string& port : *group) {
+            if (port != preferredPort) {
+                ports.push_back(port);
+            }
+        }
+    }
+    return ports;
+}
+
+int openHotplugMonitor() {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        cerr << "Failed to open uevent socket, serial hot-plug disabled: " << strerror(errno) << endl;
+        return -1;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_pid = 0;
+    address.nl_groups = 1;  // kernel uevents
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        cerr << "Failed to bind uevent socket, serial hot-plug disabled: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void closeHotplugMonitor(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool readHotplugEvents(int fd) {
+    bool ttyChanged = false;
+    char buffer[4096];
+    while (true) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer) - 1, 0);
+        if (len <= 0) {
+            break;
+        }
+        buffer[len] = '\0';
+
+        // "action@devpath\0KEY=value\0KEY=value\0..."
+        string action;
+        string subsystem;
+        for (char* field = buffer; field < buffer + len; field += strlen(field) + 1) {
+            if (strncmp(field, "ACTION=", 7) == 0) {
+                action = field + 7;
+            } else if (strncmp(field, "SUBSYSTEM=", 10) == 0) {
+                subsystem = field + 10;
+            }
+        }
+        if (subsystem == "tty" && (action == "add" || action == "remove")) {
+            ttyChanged = true;
+        }
+    }
+    return ttyChanged;
+}
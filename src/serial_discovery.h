@@ -0,0 +1,18 @@
+#ifndef SERIAL_DISCOVERY_H
+#define SERIAL_DISCOVERY_H
+
+#include "common.h"
+
+// Serial ports the camera may be on, best candidate first.
+// preferredPort (e.g. "/dev/ttyS0") is always tried first when set; USB
+// adapters matching usbId ("vvvv:pppp") come before other USB serial ports.
+vector<string> findSerialPorts(const string& preferredPort, const string& usbId);
+
+// Kernel hot-plug notifications (netlink uevents), -1 if unavailable
+int openHotplugMonitor();
+void closeHotplugMonitor(int fd);
+
+// Drain pending uevents, returns true if a tty device was added or removed
+bool readHotplugEvents(int fd);
+
+#endif // SERIAL_DISCOVERY_H
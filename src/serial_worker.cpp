@@ -0,0 +1,616 @@
+#include "serial_worker.h"
+#include "serial.h"
+#include "camera_state.h"
+#include "serial_discovery.h"
+#include "trace.h"
+#include "metrics.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+
+// A VISCA camera executes at most two commands at once (sockets 1 and 2)
+static const size_t MAX_VISCA_SOCKETS = 2;
+
+// Reply deadlines before a command or inquiry is considered lost
+static const int ACK_TIMEOUT_MS = 500;
+static const int COMPLETION_TIMEOUT_MS = 5000;
+static const int INQUIRY_TIMEOUT_MS = 500;
+
+// Spacing between commands for cameras that never send replies
+static const int NO_REPLY_INTERVAL_MS = 100;
+
+// Camera state is re-read this often while nothing else is going on
+static const int INQUIRY_INTERVAL_MS = 2000;
+
+// A cached value younger than this is trusted to skip a redundant command
+static const int STATE_TRUST_MS = 1000;
+
+static const int IDLE_WAIT_MS = 100;
+
+// Retry interval while no camera is connected, and the delay after a hot-plug
+// event before the new device node is opened
+static const int RECONNECT_INTERVAL_MS = 2000;
+static const int HOTPLUG_SETTLE_MS = 500;
+
+// Inquiries, one per cached value
+enum ViscaInquiry {
+    INQUIRY_ZOOM = 0,
+    INQUIRY_ICR,
+    INQUIRY_IR_CORRECTION,
+    INQUIRY_COUNT
+};
+
+static const ViscaPacket<5> INQUIRY_PACKETS[INQUIRY_COUNT] = {
+    VISCA_ZOOM_POSITION_INQUIRY,
+    VISCA_ICR_MODE_INQUIRY,
+    VISCA_IR_CORRECTION_INQUIRY,
+};
+
+// Command sent to the camera, waiting for ACK or Completion
+struct SentCommand {
+    ViscaCommand command;
+    steady_clock::time_point sentAt;
+    int socket;
+};
+
+static deque<ViscaCommand> pendingCommands;
+static mutex serialQueueMutex;
+static thread serialWorkerThread;
+static atomic<bool> serialWorkerRunning(false);
+
+// Wakes the worker out of poll() when a command is queued or on shutdown
+static int serialWakeFd = -1;
+
+// Netlink socket reporting USB serial adapters being plugged in or out
+static int hotplugFd = -1;
+static steady_clock::time_point nextConnectAttempt;
+
+// State below is only touched by the worker thread
+static deque<SentCommand> awaitingAck;
+static vector<SentCommand> executing;
+static ViscaReplyParser replyParser;
+static bool cameraReplies = true;
+static bool replySeen = false;
+static steady_clock::time_point lastSendTime;
+
+static deque<ViscaInquiry> pendingInquiries;
+static bool inquiryOutstanding = false;
+static ViscaInquiry outstandingInquiry = INQUIRY_ZOOM;
+static steady_clock::time_point inquirySentAt;
+static steady_clock::time_point nextInquiryBatch;
+static steady_clock::time_point confirmedAt[INQUIRY_COUNT];
+static bool confirmed[INQUIRY_COUNT] = {false};
+
+// Trace event names, one per command kind
+static const char* commandTraceName(ViscaCommandKind kind) {
+    switch (kind) {
+        case VISCA_ZOOM_DIRECT: return "visca zoom";
+        case VISCA_ZOOM_VARIABLE: return "visca zoom variable";
+        case VISCA_ICR: return "visca icr";
+        case VISCA_IR_CORRECTION: return "visca ir correction";
+        default: return "visca command";
+    }
+}
+
+// Send to completion (or error) of a command on the trace
+static void traceCommand(const SentCommand& command) {
+    if (traceEnabled.load(memory_order_relaxed)) {
+        traceEvent(commandTraceName(command.command.kind), command.sentAt, steady_clock::now());
+    }
+}
+
+static ViscaInquiry inquiryFor(ViscaCommandKind kind) {
+    switch (kind) {
+        case VISCA_ICR: return INQUIRY_ICR;
+        case VISCA_IR_CORRECTION: return INQUIRY_IR_CORRECTION;
+        default: return INQUIRY_ZOOM;
+    }
+}
+
+static void queueInquiry(ViscaInquiry inquiry) {
+    if (find(pendingInquiries.begin(), pendingInquiries.end(), inquiry) == pendingInquiries.end()) {
+        pendingInquiries.push_back(inquiry);
+    }
+}
+
+static void queueInquiryBatch() {
+    for (int i = 0; i < INQUIRY_COUNT; i++) {
+        queueInquiry(ViscaInquiry(i));
+    }
+    nextInquiryBatch = steady_clock::now() + milliseconds(INQUIRY_INTERVAL_MS);
+}
+
+// True if a command of this kind is queued or still running on the camera
+static bool commandInFlight(ViscaCommandKind kind) {
+    for (const SentCommand& sent : awaitingAck) {
+        if (sent.command.kind == kind) return true;
+    }
+    for (const SentCommand& sent : executing) {
+        if (sent.command.kind == kind) return true;
+    }
+    lock_guard<mutex> lock(serialQueueMutex);
+    for (const ViscaCommand& pending : pendingCommands) {
+        if (pending.kind == kind) return true;
+    }
+    return false;
+}
+
+static bool canSendCommand(steady_clock::time_point now) {
+    if (!cameraReplies) {
+        return now - lastSendTime >= milliseconds(NO_REPLY_INTERVAL_MS);
+    }
+    // One packet at a time until it is answered, and never more than the camera's sockets
+    return awaitingAck.empty() && !inquiryOutstanding && executing.size() < MAX_VISCA_SOCKETS;
+}
+
+static bool canSendInquiry() {
+    return cameraReplies && awaitingAck.empty() && !inquiryOutstanding;
+}
+
+static void resetCommandTracking() {
+    awaitingAck.clear();
+    executing.clear();
+    replyParser.reset();
+    cameraReplies = true;
+    replySeen = false;
+    pendingInquiries.clear();
+    inquiryOutstanding = false;
+    for (int i = 0; i < INQUIRY_COUNT; i++) {
+        confirmed[i] = false;
+    }
+}
+
+static void disconnectSerial() {
+    cameraSerial.closeDevice();
+    serialInitialized = false;
+    resetCommandTracking();
+    resetCameraState();
+    nextConnectAttempt = steady_clock::now() + milliseconds(RECONNECT_INTERVAL_MS);
+}
+
+// Open the camera port, done eagerly so the first button press never waits for it
+static void connectSerial(steady_clock::time_point now) {
+    if (!initializeSerial()) {
+        nextConnectAttempt = now + milliseconds(RECONNECT_INTERVAL_MS);
+        return;
+    }
+    resetCommandTracking();
+    queueInquiryBatch();
+    setLogMessage("Camera connected: " + getSerialPortName());
+}
+
+// Called with serialQueueMutex held
+static void publishQueueDepth() {
+    setMetricGauge(GAUGE_SERIAL_QUEUE_DEPTH, pendingCommands.size());
+}
+
+static void requeueFront(const ViscaCommand& command) {
+    lock_guard<mutex> lock(serialQueueMutex);
+    // Drop it if a newer command of the same kind was queued meanwhile
+    if (command.kind != VISCA_OTHER) {
+        for (const ViscaCommand& pending : pendingCommands) {
+            if (pending.kind == command.kind) {
+                return;
+            }
+        }
+    }
+    pendingCommands.push_front(command);
+    publishQueueDepth();
+}
+
+static bool writePacket(const unsigned char* bytes, size_t length) {
+    lastSendTime = steady_clock::now();
+    if (cameraSerial.writeBytes(bytes, length) != 1) {
+        cerr << "Serial write failed, closing port" << endl;
+        countMetric(METRIC_SERIAL_ERRORS);
+        setLogMessage("Serial error");
+        disconnectSerial();
+        return false;
+    }
+    return true;
+}
+
+// The camera already reports the requested value: nothing to send
+static bool isRedundant(const ViscaCommand& command, steady_clock::time_point now) {
+    if (command.kind == VISCA_OTHER || command.value < 0) {
+        return false;
+    }
+    ViscaInquiry inquiry = inquiryFor(command.kind);
+    if (!confirmed[inquiry] || now - confirmedAt[inquiry] > milliseconds(STATE_TRUST_MS)) {
+        return false;
+    }
+    CameraState state = getCameraState();
+    switch (command.kind) {
+        case VISCA_ZOOM_DIRECT: return state.zoomPosition == command.value;
+        case VISCA_ICR: return state.icrMode == command.value;
+        case VISCA_IR_CORRECTION: return state.irCorrection == command.value;
+        default: return false;
+    }
+}
+
+static void sendCommand(const ViscaCommand& command) {
+    if (!writePacket(command.bytes.data(), command.length)) {
+        return;
+    }
+    countMetric(METRIC_SERIAL_COMMANDS);
+    // The cached value is stale until it is read back
+    if (command.kind != VISCA_OTHER) {
+        confirmed[inquiryFor(command.kind)] = false;
+    }
+    if (cameraReplies) {
+        awaitingAck.push_back(SentCommand{command, lastSendTime, 0});
+    }
+}
+
+static void sendInquiry(ViscaInquiry inquiry) {
+    if (!writePacket(INQUIRY_PACKETS[inquiry].data(), INQUIRY_PACKETS[inquiry].size())) {
+        return;
+    }
+    inquiryOutstanding = true;
+    outstandingInquiry = inquiry;
+    inquirySentAt = lastSendTime;
+}
+
+static void handleInquiryAnswer(const ViscaReply& reply) {
+    inquiryOutstanding = false;
+    if (traceEnabled.load(memory_order_relaxed)) {
+        traceEvent("visca inquiry", inquirySentAt, steady_clock::now());
+    }
+
+    // A command of the same kind may change the value again, wait for its completion
+    if (outstandingInquiry == INQUIRY_ZOOM ?
+            commandInFlight(VISCA_ZOOM_DIRECT) || commandInFlight(VISCA_ZOOM_VARIABLE) :
+            commandInFlight(outstandingInquiry == INQUIRY_ICR ? VISCA_ICR : VISCA_IR_CORRECTION)) {
+        return;
+    }
+
+    switch (outstandingInquiry) {
+        case INQUIRY_ZOOM:
+            // 90 50 0p 0q 0r 0s FF
+            if (reply.payloadSize != 4) return;
+            updateCameraZoomPosition(viscaDecodeNibbles(reply.payload, 4));
+            break;
+        case INQUIRY_ICR:
+            // 90 50 02 FF = on, 90 50 03 FF = off
+            if (reply.payloadSize != 1) return;
+            updateCameraICRMode(reply.payload[0] == 0x02);
+            break;
+        case INQUIRY_IR_CORRECTION:
+            // 90 50 00 FF = standard, 90 50 01 FF = IR light
+            if (reply.payloadSize != 1) return;
+            updateCameraIRCorrection(reply.payload[0] == 0x01);
+            break;
+        default:
+            return;
+    }
+    confirmed[outstandingInquiry] = true;
+    confirmedAt[outstandingInquiry] = steady_clock::now();
+}
+
+static void reportCameraError(int errorCode) {
+    updateCameraError(errorCode);
+    countMetric(METRIC_SERIAL_ERRORS);
+    switch (errorCode) {
+        case VISCA_ERROR_SYNTAX: setLogMessage("Camera: syntax error"); break;
+        case VISCA_ERROR_NOT_EXECUTABLE: setLogMessage("Camera: command not executable"); break;
+        case VISCA_ERROR_CANCELED: break;
+        default: setLogMessage("Camera error"); break;
+    }
+}
+
+static void handleReply(const ViscaReply& reply) {
+    replySeen = true;
+    cameraReplies = true;
+
+    if (reply.type == ViscaReply::ACK) {
+        // The oldest unacknowledged command now runs in this socket
+        if (!awaitingAck.empty()) {
+            SentCommand command = awaitingAck.front();
+            awaitingAck.pop_front();
+            command.socket = reply.socket;
+            executing.push_back(command);
+        }
+    } else if (reply.type == ViscaReply::COMPLETION) {
+        if (reply.socket == 0) {
+            if (inquiryOutstanding) {
+                handleInquiryAnswer(reply);
+            }
+            return;
+        }
+        for (auto it = executing.begin(); it != executing.end(); ++it) {
+            if (it->socket == reply.socket) {
+                // Read back what the command actually did
+                if (it->command.kind != VISCA_OTHER) {
+                    queueInquiry(inquiryFor(it->command.kind));
+                }
+                traceCommand(*it);
+                executing.erase(it);
+                break;
+            }
+        }
+    } else if (reply.type == ViscaReply::ERROR) {
+        if (reply.errorCode == VISCA_ERROR_BUFFER_FULL && !awaitingAck.empty()) {
+            // Command buffer full: try the same command again once a socket frees up
+            SentCommand command = awaitingAck.front();
+            awaitingAck.pop_front();
+            requeueFront(command.command);
+            return;
+        }
+
+        cerr << "VISCA error " << hex << reply.errorCode << dec << " on socket " << reply.socket << endl;
+        reportCameraError(reply.errorCode);
+
+        bool released = false;
+        for (auto it = executing.begin(); it != executing.end(); ++it) {
+            if (reply.socket != 0 && it->socket == reply.socket) {
+                queueInquiry(inquiryFor(it->command.kind));
+                traceCommand(*it);
+                executing.erase(it);
+                released = true;
+                break;
+            }
+        }
+        if (!released) {
+            if (!awaitingAck.empty()) {
+                queueInquiry(inquiryFor(awaitingAck.front().command.kind));
+                traceCommand(awaitingAck.front());
+                awaitingAck.pop_front();
+            } else if (inquiryOutstanding) {
+                inquiryOutstanding = false;
+            }
+        }
+    }
+}
+
+// Drain everything the port has, returns false if the port went away
+static bool readReplies() {
+    unsigned char buffer[64];
+    while (true) {
+        ssize_t count = read(cameraSerial.getFileDescriptor(), buffer, sizeof(buffer));
+        if (count > 0) {
+            replyParser.feed(buffer, count, handleReply);
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+        return true;
+    }
+}
+
+static void expireCommands(steady_clock::time_point now) {
+    while (!awaitingAck.empty() && now - awaitingAck.front().sentAt >= milliseconds(ACK_TIMEOUT_MS)) {
+        awaitingAck.pop_front();
+        if (cameraReplies) {
+            countMetric(METRIC_SERIAL_ERRORS);
+        }
+        if (!replySeen && cameraReplies) {
+            // Some cameras never answer; fall back to paced fire-and-forget
+            cout << "Camera does not acknowledge commands, pacing them instead" << endl;
+            cameraReplies = false;
+            awaitingAck.clear();
+            executing.clear();
+            pendingInquiries.clear();
+        }
+    }
+    executing.erase(remove_if(executing.begin(), executing.end(),
+                              [now](const SentCommand& command) {
+                                  if (now - command.sentAt < milliseconds(COMPLETION_TIMEOUT_MS)) {
+                                      return false;
+                                  }
+                                  countMetric(METRIC_SERIAL_ERRORS);
+                                  return true;
+                              }),
+                    executing.end());
+    if (inquiryOutstanding && now - inquirySentAt >= milliseconds(INQUIRY_TIMEOUT_MS)) {
+        inquiryOutstanding = false;
+    }
+}
+
+// How long poll() may sleep before some deadline needs attention
+static int pollTimeout(steady_clock::time_point now, bool hasPending) {
+    steady_clock::time_point wakeAt = now + milliseconds(IDLE_WAIT_MS);
+    if (!serialInitialized) {
+        wakeAt = max(now, nextConnectAttempt);
+    } else {
+        if (cameraReplies) {
+            wakeAt = min(wakeAt, nextInquiryBatch);
+        }
+        if (!awaitingAck.empty()) {
+            wakeAt = min(wakeAt, awaitingAck.front().sentAt + milliseconds(ACK_TIMEOUT_MS));
+        }
+        for (const SentCommand& command : executing) {
+            wakeAt = min(wakeAt, command.sentAt + milliseconds(COMPLETION_TIMEOUT_MS));
+        }
+        if (inquiryOutstanding) {
+            wakeAt = min(wakeAt, inquirySentAt + milliseconds(INQUIRY_TIMEOUT_MS));
+        }
+        if (!cameraReplies && hasPending) {
+            wakeAt = min(wakeAt, lastSendTime + milliseconds(NO_REPLY_INTERVAL_MS));
+        }
+    }
+    long long timeoutMs = duration_cast<milliseconds>(wakeAt - now).count();
+    return int(max(0LL, timeoutMs));
+}
+
+static void serialWorkerLoop() {
+    setTraceThreadName("serial");
+    while (serialWorkerRunning) {
+        bool hasPending;
+        {
+            lock_guard<mutex> lock(serialQueueMutex);
+            hasPending = !pendingCommands.empty();
+        }
+
+        if (!serialInitialized) {
+            if (steady_clock::now() >= nextConnectAttempt) {
+                connectSerial(steady_clock::now());
+            }
+            // Nothing can be sent without a camera; don't replay stale commands later
+            if (!serialInitialized && hasPending) {
+                lock_guard<mutex> lock(serialQueueMutex);
+                pendingCommands.clear();
+                publishQueueDepth();
+                hasPending = false;
+                setLogMessage("Camera not connected");
+            }
+        }
+
+        // Sleep until the camera answers, a command is queued, a device is
+        // plugged in or out, or a deadline passes
+        struct pollfd fds[3];
+        fds[0].fd = serialWakeFd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = hotplugFd;      // ignored by poll() when -1
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        nfds_t fdCount = 2;
+        if (serialInitialized) {
+            fds[2].fd = cameraSerial.getFileDescriptor();
+            fds[2].events = POLLIN;
+            fds[2].revents = 0;
+            fdCount = 3;
+        }
+
+        bool canSendNow = serialInitialized && hasPending && canSendCommand(steady_clock::now());
+        int timeout = canSendNow ? 0 : pollTimeout(steady_clock::now(), hasPending);
+        if (poll(fds, fdCount, timeout) < 0 && errno != EINTR) {
+            cerr << "Serial poll failed: " << strerror(errno) << endl;
+            this_thread::sleep_for(milliseconds(IDLE_WAIT_MS));
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t wakeups;
+            if (read(serialWakeFd, &wakeups, sizeof(wakeups)) < 0) {
+                // Counter already drained, nothing to do
+            }
+        }
+        if ((fds[1].revents & POLLIN) && readHotplugEvents(hotplugFd) && !serialInitialized) {
+            // Give udev a moment to create the device node and set its permissions
+            nextConnectAttempt = steady_clock::now() + milliseconds(HOTPLUG_SETTLE_MS);
+        }
+        if (!serialWorkerRunning || !serialInitialized) {
+            continue;
+        }
+
+        if (fdCount == 3) {
+            if ((fds[2].revents & POLLIN) && !readReplies()) {
+                cerr << "Serial read failed, closing port" << endl;
+                countMetric(METRIC_SERIAL_ERRORS);
+                setLogMessage("Serial error");
+                disconnectSerial();
+                continue;
+            }
+            if (fds[2].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+                cerr << "Serial port disconnected" << endl;
+                countMetric(METRIC_SERIAL_ERRORS);
+                setLogMessage("Camera disconnected");
+                disconnectSerial();
+                continue;
+            }
+        }
+
+        steady_clock::time_point now = steady_clock::now();
+        expireCommands(now);
+
+        if (canSendCommand(now)) {
+            ViscaCommand command;
+            bool sendNow = false;
+            {
+                lock_guard<mutex> lock(serialQueueMutex);
+                while (!pendingCommands.empty()) {
+                    command = pendingCommands.front();
+                    pendingCommands.pop_front();
+                    if (!isRedundant(command, now)) {
+                        sendNow = true;
+                        break;
+                    }
+                }
+                publishQueueDepth();
+            }
+            if (sendNow) {
+                sendCommand(command);
+                continue;
+            }
+        }
+
+        if (cameraReplies && now >= nextInquiryBatch) {
+            queueInquiryBatch();
+        }
+        if (!pendingInquiries.empty() && canSendInquiry()) {
+            ViscaInquiry inquiry = pendingInquiries.front();
+            pendingInquiries.pop_front();
+            sendInquiry(inquiry);
+        }
+    }
+}
+
+static void wakeSerialWorker() {
+    uint64_t one = 1;
+    if (write(serialWakeFd, &one, sizeof(one)) < 0) {
+        // Counter saturated, the worker is awake anyway
+    }
+}
+
+void startSerialWorker() {
+    if (serialWorkerRunning) {
+        return;
+    }
+    serialWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (serialWakeFd < 0) {
+        cerr << "Failed to create serial wakeup eventfd: " << strerror(errno) << endl;
+        return;
+    }
+    hotplugFd = openHotplugMonitor();
+    nextConnectAttempt = steady_clock::now();
+    serialWorkerRunning = true;
+    serialWorkerThread = thread(serialWorkerLoop);
+}
+
+void stopSerialWorker() {
+    if (!serialWorkerRunning) {
+        return;
+    }
+    serialWorkerRunning = false;
+    wakeSerialWorker();
+    if (serialWorkerThread.joinable()) {
+        serialWorkerThread.join();
+    }
+    if (serialInitialized) {
+        disconnectSerial();
+    }
+    close(serialWakeFd);
+    serialWakeFd = -1;
+    closeHotplugMonitor(hotplugFd);
+    hotplugFd = -1;
+}
+
+void queueViscaCommand(ViscaCommandKind kind, const uint8_t* bytes, size_t length, bool supersede, int value) {
+    ViscaCommand command;
+    command.kind = kind;
+    command.length = min(length, command.bytes.size());
+    copy(bytes, bytes + command.length, command.bytes.begin());
+    command.value = value;
+
+    {
+        lock_guard<mutex> lock(serialQueueMutex);
+        if (kind != VISCA_OTHER) {
+            for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it) {
+                if (it->kind == kind) {
+                    if (!supersede) {
+                        return;
+                    }
+                    // The queued command has not been sent yet, the new one replaces it
+                    pendingCommands.erase(it);
+                    break;
+                }
+            }
+        }
+        pendingCommands.push_back(command);
+        publishQueueDepth();
+    }
+    if (serialWakeFd >= 0) {
+        wakeSerialWorker();
+    }
+}
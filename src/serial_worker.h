@@ -0,0 +1,43 @@
+#ifndef SERIAL_WORKER_H
+#define SERIAL_WORKER_H
+
+#include "common.h"
+#include "visca_commands.h"
+#include "visca_reply.h"
+
+// Command groups; a new command replaces a queued one of the same group
+// (only the latest zoom target or ICR state matters)
+enum ViscaCommandKind {
+    VISCA_OTHER = 0,        // never coalesced
+    VISCA_ZOOM_DIRECT,
+    VISCA_ZOOM_VARIABLE,    // tele/wide/stop, a stop replaces an unsent start
+    VISCA_ICR,
+    VISCA_IR_CORRECTION
+};
+
+struct ViscaCommand {
+    ViscaCommandKind kind;
+    array<uint8_t, VISCA_MAX_PACKET> bytes;
+    size_t length;
+    int value;      // state the command sets (zoom position, 1/0), -1 if none
+};
+
+// Start/stop the thread that owns the camera serial port. It connects as soon
+// as the camera is found and reconnects when the adapter is plugged back in.
+void startSerialWorker();
+void stopSerialWorker();
+
+// Queue a command for the camera, never blocks on the serial port.
+// With supersede = false the command is dropped if one of the same kind is queued.
+// A command whose value the camera just reported is not sent at all.
+void queueViscaCommand(ViscaCommandKind kind, const uint8_t* bytes, size_t length,
+                       bool supersede = true, int value = -1);
+
+template<size_t N>
+void queueViscaCommand(ViscaCommandKind kind, const ViscaPacket<N>& packet,
+                       bool supersede = true, int value = -1) {
+    static_assert(N <= VISCA_MAX_PACKET, "VISCA packet too long");
+    queueViscaCommand(kind, packet.data(), N, supersede, value);
+}
+
+#endif // SERIAL_WORKER_H
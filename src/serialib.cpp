@@ -365,6 +365,17 @@ bool serialib::isDeviceOpen()
 #endif
 }
 
+#if defined (__linux__) || defined(__APPLE__)
+/*!
+     \brief Return the file descriptor of the device
+     \return the descriptor, or -1 if the device is closed
+*/
+int serialib::getFileDescriptor()
+{
+    return fd;
+}
+#endif
+
 /*!
      \brief Close the connection with the current device
 */
@@ -119,6 +119,11 @@ public:
     // Check device opening state
     bool isDeviceOpen();
 
+#if defined (__linux__) || defined(__APPLE__)
+    // File descriptor of the device, to wait for data with poll/epoll
+    int getFileDescriptor();
+#endif
+
     // Close the current device
     void    closeDevice();
 
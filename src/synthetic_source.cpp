@@ -0,0 +1,148 @@
+#include "synthetic_source.h"
+
+// Features of the background texture, px
+static const int TEXTURE_SCALE = 24;
+
+SyntheticDripSource::SyntheticDripSource(const SyntheticSceneOptions& sceneOptions)
+    : options(sceneOptions), rng(sceneOptions.seed) {
+    if (options.dropSources.empty()) {
+        int width = options.frameSize.width;
+        int height = options.frameSize.height;
+        options.dropSources = {Point(width / 4, height / 4), Point(width / 2, height / 3),
+                               Point(3 * width / 4, height / 5)};
+    }
+    renderBackground();
+    noise.create(options.frameSize, CV_16SC3);
+    for (size_t i = 0; i < options.dropSources.size(); i++) {
+        nextDropFrame.push_back(framesUntilNextDrop());
+    }
+    startTime = steady_clock::now();
+}
+
+// Stained concrete: smooth blotches over a vertical light gradient
+void SyntheticDripSource::renderBackground() {
+    Size size = options.frameSize;
+    Mat blotches(Size(max(1, size.width / TEXTURE_SCALE), max(1, size.height / TEXTURE_SCALE)), CV_8UC1);
+    rng.fill(blotches, RNG::UNIFORM, 0, 40);
+    resize(blotches, blotches, size, 0, 0, INTER_CUBIC);
+    GaussianBlur(blotches, blotches, Size(0, 0), TEXTURE_SCALE / 3.0);
+
+    Mat gray(size, CV_8UC1);
+    for (int y = 0; y < size.height; y++) {
+        uint8_t base = saturate_cast<uint8_t>(70 + 50.0 * y / size.height);
+        const uint8_t* blotchRow = blotches.ptr<uint8_t>(y);
+        uint8_t* row = gray.ptr<uint8_t>(y);
+        for (int x = 0; x < size.width; x++) {
+            row[x] = saturate_cast<uint8_t>(base + blotchRow[x] - 20);
+        }
+    }
+
+    if (options.infrared) {
+        cvtColor(gray, background, COLOR_GRAY2BGR);
+    } else {
+        // Slightly warm tint, as under the site lighting
+        Mat channels[3] = {gray * 0.9, gray, gray * 1.05};
+        merge(channels, 3, background);
+    }
+}
+
+int SyntheticDripSource::framesUntilNextDrop() {
+    // Exponential gaps around the average interval, at least a frame apart
+    double gap = -log(1.0 - rng.uniform(0.0, 0.999)) * options.dropIntervalSeconds;
+    return frameIndex + max(1, cvRound(gap * options.fps));
+}
+
+int SyntheticDripSource::fallFrames() const {
+    // Frames until the drop has covered fallDistance
+    double a = options.dropAcceleration;
+    double v = options.dropSpeed;
+    double d = options.fallDistance;
+    double seconds = a > 0 ? (-v + sqrt(v * v + 2 * a * d)) / a : d / max(v, 1.0);
+    return max(1, cvCeil(seconds * options.fps));
+}
+
+Point SyntheticDripSource::dropPosition(const SyntheticDrop& drop, int frame) const {
+    double t = (frame - drop.firstFrame) / options.fps;
+    double fallen = options.dropSpeed * t + 0.5 * options.dropAcceleration * t * t;
+    return Point(drop.source.x, drop.source.y + cvRound(fallen));
+}
+
+bool SyntheticDripSource::read(Mat& frame) {
+    if (options.realTime) {
+        this_thread::sleep_until(startTime + duration_cast<steady_clock::duration>(
+                                     duration<double>(frameIndex / options.fps)));
+    }
+
+    // Background, slowly changing brightness
+    double gain = 1.0;
+    if (options.backgroundDrift > 0) {
+        double t = frameIndex / options.fps;
+        gain += options.backgroundDrift * sin(2 * CV_PI * t / options.driftPeriodSeconds);
+    }
+    background.convertTo(frame, CV_8UC3, gain);
+
+    // Drops that hit the floor are only kept for the ground truth; all drops
+    // fall for the same time, so the finished ones are at the front
+    if (!options.keepDropHistory) {
+        auto falling = find_if(drops.begin(), drops.end(),
+                               [this](const SyntheticDrop& drop) { return drop.lastFrame >= frameIndex; });
+        drops.erase(drops.begin(), falling);
+    }
+
+    // Start new drops
+    for (size_t i = 0; i < options.dropSources.size(); i++) {
+        if (frameIndex >= nextDropFrame[i]) {
+            drops.push_back(SyntheticDrop{nextDropId++, frameIndex,
+                                          frameIndex + fallFrames() - 1,
+                                          options.dropSources[i], options.dropRadius});
+            nextDropFrame[i] = framesUntilNextDrop();
+        }
+    }
+
+    // A drop reflects the light: a bright, slightly elongated body with a darker rim
+    // (all drops fall for the same time, so the visible ones are at the end)
+    for (auto it = drops.rbegin(); it != drops.rend() && it->lastFrame >= frameIndex; ++it) {
+        Point center = dropPosition(*it, frameIndex);
+        Size axes(it->radius, it->radius + it->radius / 2);
+        ellipse(frame, center, axes + Size(1, 1), 0, 0, 360, Scalar(40, 40, 40), -1, LINE_AA);
+        ellipse(frame, center, axes, 0, 0, 360, Scalar(215, 220, 225), -1, LINE_AA);
+        circle(frame, center - Point(it->radius / 3, it->radius / 3), max(1, it->radius / 3),
+               Scalar(255, 255, 255), -1, LINE_AA);
+    }
+
+    // Sensor noise
+    if (options.noiseSigma > 0) {
+        rng.fill(noise, RNG::NORMAL, 0, options.noiseSigma);
+        add(frame, noise, frame, noArray(), CV_8UC3);
+    }
+    if (options.infrared) {
+        // The noise must stay grey too
+        cvtColor(frame, frame, COLOR_BGR2GRAY);
+        cvtColor(frame, frame, COLOR_GRAY2BGR);
+    }
+
+    frameIndex++;
+    return true;
+}
+
+bool SyntheticDripSource::writeGroundTruth(const string& path) const {
+    if (!options.keepDropHistory) {
+        cerr << "No ground truth, the scene does not keep its drop history" << endl;
+        return false;
+    }
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Failed to write ground truth to " << path << endl;
+        return false;
+    }
+    file << "# fps=" << options.fps << " speed_px_s=" << options.dropSpeed
+         << " acceleration_px_s2=" << options.dropAcceleration << "\n";
+    file << "Id,FirstFrame,LastFrame,StartTime,SourceX,SourceY,EndY,Radius\n";
+    for (const SyntheticDrop& drop : drops) {
+        file << drop.id << ',' << drop.firstFrame << ',' << drop.lastFrame << ','
+             << fixed << setprecision(3) << drop.firstFrame / options.fps << ','
+             << drop.source.x << ',' << drop.source.y << ',' << dropPosition(drop, drop.lastFrame).y
+             << ',' << drop.radius << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include "common.h"
+
+// A synthetic scene: a textured wall seen by the camera, with drops falling
+// from fixed points. Everything comes from the seed, so a scene renders
+// identically on every machine.
+struct SyntheticSceneOptions {
+    Size frameSize = Size(1280, 720);
+    double fps = 30.0;
+    unsigned seed = 1;
+    double noiseSigma = 3.0;            // sensor noise, grey levels
+    double backgroundDrift = 0.0;       // brightness swing of the background (0.05 = +-5%)
+    double driftPeriodSeconds = 60.0;
+    bool infrared = false;              // ICR on: monochrome picture
+    int dropRadius = 3;                 // px
+    double dropSpeed = 300.0;           // px/s when it starts to fall
+    double dropAcceleration = 0.0;      // px/s^2, 0 = constant speed
+    double dropIntervalSeconds = 2.0;   // average time between drops of one source
+    int fallDistance = 200;             // px before the drop hits the floor and disappears
+    vector<Point> dropSources;          // empty: three sources spread across the frame
+    bool realTime = false;              // read() waits for the frame time, like a camera
+    bool keepDropHistory = true;        // false: only falling drops are kept, no ground truth
+};
+
+// One drop as it appears in the video
+struct SyntheticDrop {
+    int id;
+    int firstFrame;
+    int lastFrame;
+    Point source;
+    int radius;
+};
+
+class SyntheticDripSource {
+public:
+    explicit SyntheticDripSource(const SyntheticSceneOptions& options = SyntheticSceneOptions());
+
+    // Render the next frame (same contract as VideoCapture::read)
+    bool read(Mat& frame);
+
+    int getFrameIndex() const { return frameIndex; }
+    const SyntheticSceneOptions& getOptions() const { return options; }
+
+    // Drops started so far, in order (only the falling ones without keepDropHistory)
+    const vector<SyntheticDrop>& getDrops() const { return drops; }
+
+    // Centre of a drop in a frame, falling straight down from its source
+    Point dropPosition(const SyntheticDrop& drop, int frame) const;
+
+    // Ground truth as CSV, one line per drop; needs keepDropHistory
+    bool writeGroundTruth(const string& path) const;
+
+private:
+    SyntheticSceneOptions options;
+    RNG rng;
+    Mat background;                 // CV_8UC3
+    Mat noise;                      // CV_16SC3, reused every frame
+    vector<int> nextDropFrame;      // per source
+    vector<SyntheticDrop> drops;
+    int nextDropId = 1;
+    int frameIndex = 0;
+    steady_clock::time_point startTime;
+
+    void renderBackground();
+    int framesUntilNextDrop();
+    int fallFrames() const;
+};
+
+#endif // SYNTHETIC_SOURCE_H
@@ -0,0 +1,219 @@
+#include "thumbnail_job.h"
+#include "recordings_catalog.h"
+#include "trace.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <set>
+
+const int THUMBNAIL_FRAMES = 4;
+const Size THUMBNAIL_SIZE(48, 27);
+
+static const char* THUMBNAIL_DIR = ".thumbs/";
+
+// Chunks walked before giving up on a damaged file
+static const size_t MAX_AVI_CHUNKS = 10000000;
+
+// ioprio_set() has no glibc wrapper
+static const int IOPRIO_WHO_PROCESS = 1;
+static const int IOPRIO_CLASS_IDLE = 3;
+static const int IOPRIO_CLASS_SHIFT = 13;
+
+static thread thumbnailThread;
+static atomic<bool> thumbnailRunning(false);
+static mutex thumbnailMutex;
+static condition_variable thumbnailCondition;
+static deque<string> thumbnailQueue;
+static set<string> thumbnailPending;
+
+string thumbnailFileFor(const string& recordingName) {
+    return string(THUMBNAIL_DIR) + recordingName + ".jpg";
+}
+
+// Only run when nothing else wants the CPU or the disk
+static void lowerThreadPriority() {
+    struct sched_param param = {};
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+    }
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+}
+
+static bool readAt(int fd, off_t offset, void* data, size_t size) {
+    return pread(fd, data, size, offset) == ssize_t(size);
+}
+
+static uint32_t readLE32(const char* bytes) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(bytes);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | (uint32_t(b[3]) << 24);
+}
+
+// Offset and size of every video chunk in the movi lists of an AVI file,
+// including the AVIX extensions of large (OpenDML) files. Only chunk
+// headers are read, the frame data is skipped over.
+static bool findAviFrames(int fd, off_t fileSize, vector<pair<off_t, uint32_t>>& frames) {
+    char header[12];
+    off_t riffOffset = 0;
+    size_t chunks = 0;
+
+    while (riffOffset + 12 <= fileSize && readAt(fd, riffOffset, header, 12) &&
+           memcmp(header, "RIFF", 4) == 0) {
+        off_t riffEnd = min(fileSize, riffOffset + 8 + off_t(readLE32(header + 4)));
+        off_t offset = riffOffset + 12;
+
+        while (offset + 8 <= riffEnd && chunks++ < MAX_AVI_CHUNKS) {
+            if (!readAt(fd, offset, header, 12)) {
+                break;
+            }
+            uint32_t size = readLE32(header + 4);
+            if (memcmp(header, "LIST", 4) == 0 && memcmp(header + 8, "movi", 4) == 0) {
+                // Step into the movi list instead of over it
+                offset += 12;
+                continue;
+            }
+            // Video chunks are "##dc" (compressed) or "##db" (uncompressed)
+            if (header[2] == 'd' && (header[3] == 'c' || header[3] == 'b') && size > 0) {
+                frames.emplace_back(offset + 8, size);
+            }
+            offset += 8 + size + (size & 1);
+        }
+        riffOffset = riffEnd + (riffEnd & 1);
+    }
+    return !frames.empty();
+}
+
+// Decode evenly spaced MJPEG frames straight from the file. The JPEG decoder
+// scales during the DCT (IMREAD_REDUCED_*), so no frame is decoded at full size.
+static bool extractAviKeyframes(const string& path, vector<Mat>& images) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    vector<pair<off_t, uint32_t>> frames;
+    if (fstat(fd, &fileStat) != 0 || !findAviFrames(fd, fileStat.st_size, frames)) {
+        close(fd);
+        return false;
+    }
+
+    vector<uchar> jpeg;
+    for (int i = 0; i < THUMBNAIL_FRAMES; i++) {
+        // Centre of each equal slice of the recording
+        const auto& frame = frames[(frames.size() * (2 * i + 1)) / (2 * THUMBNAIL_FRAMES)];
+        jpeg.resize(frame.second);
+        if (!readAt(fd, frame.first, jpeg.data(), jpeg.size()) ||
+            jpeg.size() < 2 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+            break;
+        }
+        Mat image = imdecode(jpeg, IMREAD_REDUCED_COLOR_8);
+        if (image.empty()) {
+            break;
+        }
+        images.push_back(image);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return int(images.size()) == THUMBNAIL_FRAMES;
+}
+
+// Anything that is not MJPEG in AVI is opened through OpenCV
+static bool extractDecodedKeyframes(const string& path, vector<Mat>& images) {
+    VideoCapture video(path);
+    double frameCount = video.get(CAP_PROP_FRAME_COUNT);
+    if (!video.isOpened() || frameCount < 1) {
+        return false;
+    }
+    for (int i = 0; i < THUMBNAIL_FRAMES; i++) {
+        Mat image;
+        video.set(CAP_PROP_POS_FRAMES, (frameCount * (2 * i + 1)) / (2 * THUMBNAIL_FRAMES));
+        if (!video.read(image) || image.empty()) {
+            return false;
+        }
+        images.push_back(image);
+    }
+    return true;
+}
+
+static void buildThumbnail(const string& recordingName) {
+    TRACE_SCOPE("thumbnail");
+    string path = string(RECORDINGS_DIR) + recordingName;
+    vector<Mat> images;
+    if (!extractAviKeyframes(path, images)) {
+        images.clear();
+        if (!extractDecodedKeyframes(path, images)) {
+            cerr << "No preview frames in " << path << endl;
+            return;
+        }
+    }
+
+    for (Mat& image : images) {
+        resize(image, image, THUMBNAIL_SIZE, 0, 0, INTER_AREA);
+    }
+    Mat strip;
+    hconcat(images, strip);
+
+    string thumbnail = thumbnailFileFor(recordingName);
+    filesystem::create_directories(string(RECORDINGS_DIR) + THUMBNAIL_DIR);
+    if (!imwrite(string(RECORDINGS_DIR) + thumbnail, strip, {IMWRITE_JPEG_QUALITY, 80})) {
+        cerr << "Failed to write preview " << thumbnail << endl;
+        return;
+    }
+    setRecordingThumbnail(recordingName, thumbnail);
+}
+
+static void runThumbnailJob() {
+    setTraceThreadName("thumbnails");
+    lowerThreadPriority();
+
+    while (true) {
+        string recordingName;
+        {
+            unique_lock<mutex> lock(thumbnailMutex);
+            thumbnailCondition.wait(lock, [] {
+                return !thumbnailRunning || !thumbnailQueue.empty();
+            });
+            if (!thumbnailRunning) {
+                return;
+            }
+            recordingName = thumbnailQueue.front();
+            thumbnailQueue.pop_front();
+            thumbnailPending.erase(recordingName);
+        }
+        buildThumbnail(recordingName);
+    }
+}
+
+void startThumbnailJob() {
+    if (thumbnailRunning) {
+        return;
+    }
+    thumbnailRunning = true;
+    thumbnailThread = thread(runThumbnailJob);
+}
+
+void stopThumbnailJob() {
+    {
+        lock_guard<mutex> lock(thumbnailMutex);
+        thumbnailRunning = false;
+        thumbnailQueue.clear();
+        thumbnailPending.clear();
+    }
+    thumbnailCondition.notify_one();
+    if (thumbnailThread.joinable()) {
+        thumbnailThread.join();
+    }
+}
+
+void queueThumbnail(const string& recordingName) {
+    {
+        lock_guard<mutex> lock(thumbnailMutex);
+        if (!thumbnailPending.insert(recordingName).second) {
+            return;
+        }
+        thumbnailQueue.push_back(recordingName);
+    }
+    thumbnailCondition.notify_one();
+}
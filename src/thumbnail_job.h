@@ -0,0 +1,20 @@
+#ifndef THUMBNAIL_JOB_H
+#define THUMBNAIL_JOB_H
+
+#include "common.h"
+
+// Frames in a recording's preview strip, and the size of each
+extern const int THUMBNAIL_FRAMES;
+extern const Size THUMBNAIL_SIZE;
+
+// Start/stop the idle-priority thread that builds preview strips
+void startThumbnailJob();
+void stopThumbnailJob();
+
+// Ask for the preview strip of a recording; the catalog is updated when it is written
+void queueThumbnail(const string& recordingName);
+
+// Where the preview strip of a recording is kept, relative to the recordings directory
+string thumbnailFileFor(const string& recordingName);
+
+#endif // THUMBNAIL_JOB_H
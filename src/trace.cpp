@@ -0,0 +1,194 @@
+#include "trace.h"
+#include <sys/syscall.h>
+#include <csignal>
+
+atomic<bool> traceEnabled(false);
+
+// Events kept per thread, the oldest are overwritten (about half a minute of the main loop)
+static const size_t TRACE_BUFFER_EVENTS = 8192;
+
+struct TraceRecord {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+    int tid;
+};
+
+// One producer (the owning thread), read by writeTrace(). A buffer is handed
+// to a new thread when its owner exits, which is why each record keeps its tid.
+struct TraceBuffer {
+    TraceRecord records[TRACE_BUFFER_EVENTS];
+    atomic<uint64_t> head{0};
+    bool inUse = false;
+};
+
+static mutex traceMutex;
+static vector<unique_ptr<TraceBuffer>> traceBuffers;
+static map<int, string> traceThreadNames;
+static const steady_clock::time_point traceEpoch = steady_clock::now();
+
+// Start of the current recording session, relative to traceEpoch. Heads are
+// never reset (only their owning threads write them); records from earlier
+// sessions, including scopes that were open when tracing restarted, are
+// left out when the trace is written.
+static atomic<int64_t> traceSessionStartNs(0);
+static volatile sig_atomic_t traceRequested = 0;
+
+static int currentTid() {
+    static thread_local int tid = int(syscall(SYS_gettid));
+    return tid;
+}
+
+// Returns the thread's buffer to the pool when the thread exits
+struct TraceBufferLease {
+    TraceBuffer* buffer = nullptr;
+    ~TraceBufferLease() {
+        if (buffer) {
+            lock_guard<mutex> lock(traceMutex);
+            buffer->inUse = false;
+        }
+    }
+};
+
+static TraceBuffer* threadBuffer() {
+    static thread_local TraceBufferLease lease;
+    if (!lease.buffer) {
+        lock_guard<mutex> lock(traceMutex);
+        for (auto& buffer : traceBuffers) {
+            if (!buffer->inUse) {
+                lease.buffer = buffer.get();
+                break;
+            }
+        }
+        if (!lease.buffer) {
+            traceBuffers.emplace_back(new TraceBuffer());
+            lease.buffer = traceBuffers.back().get();
+        }
+        lease.buffer->inUse = true;
+    }
+    return lease.buffer;
+}
+
+void setTraceThreadName(const char* name) {
+    lock_guard<mutex> lock(traceMutex);
+    traceThreadNames[currentTid()] = name;
+}
+
+void traceEvent(const char* name, steady_clock::time_point start, steady_clock::time_point end) {
+    TraceBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->head.load(memory_order_relaxed);
+    TraceRecord& record = buffer->records[head % TRACE_BUFFER_EVENTS];
+    record.name = name;
+    record.startNs = duration_cast<nanoseconds>(start - traceEpoch).count();
+    record.durationNs = duration_cast<nanoseconds>(end - start).count();
+    record.tid = currentTid();
+    buffer->head.store(head + 1, memory_order_release);
+}
+
+void startTracing() {
+    traceSessionStartNs.store(duration_cast<nanoseconds>(steady_clock::now() - traceEpoch).count());
+    traceEnabled = true;
+}
+
+void stopTracing() {
+    traceEnabled = false;
+}
+
+static void writeJsonString(ostream& out, const string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (uint8_t(c) >= 0x20) {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+bool writeTrace(const string& path) {
+    // Copy the rings first, then drop whatever was overwritten while copying
+    vector<TraceRecord> records;
+    map<int, string> threadNames;
+    {
+        lock_guard<mutex> lock(traceMutex);
+        threadNames = traceThreadNames;
+        for (auto& buffer : traceBuffers) {
+            uint64_t head = buffer->head.load(memory_order_acquire);
+            uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+            size_t copied = records.size();
+            for (uint64_t i = first; i < head; i++) {
+                records.push_back(buffer->records[i % TRACE_BUFFER_EVENTS]);
+            }
+            uint64_t headAfter = buffer->head.load(memory_order_acquire);
+            uint64_t valid = headAfter >= TRACE_BUFFER_EVENTS ? headAfter - TRACE_BUFFER_EVENTS + 1 : 0;
+            if (valid > first) {
+                records.erase(records.begin() + copied,
+                              records.begin() + copied + min<uint64_t>(valid - first, head - first));
+            }
+        }
+    }
+    int64_t sessionStartNs = traceSessionStartNs.load();
+    records.erase(remove_if(records.begin(), records.end(),
+                            [sessionStartNs](const TraceRecord& record) {
+                                return record.startNs < sessionStartNs;
+                            }),
+                  records.end());
+
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Failed to write trace to " << path << endl;
+        return false;
+    }
+
+    int pid = getpid();
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& thread : threadNames) {
+        file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+             << ",\"tid\":" << thread.first << ",\"args\":{\"name\":";
+        writeJsonString(file, thread.second);
+        file << "}}";
+        first = false;
+    }
+    file << fixed << setprecision(3);
+    for (const TraceRecord& record : records) {
+        file << (first ? "" : ",\n") << "{\"ph\":\"X\",\"name\":";
+        writeJsonString(file, record.name);
+        file << ",\"pid\":" << pid << ",\"tid\":" << record.tid
+             << ",\"ts\":" << record.startNs / 1000.0 << ",\"dur\":" << record.durationNs / 1000.0 << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+void saveTrace() {
+    time_t now = time(0);
+    char buffer[80];
+    strftime(buffer, 80, "./trace_%Y%m%d_%H%M%S.json", localtime(&now));
+    if (writeTrace(buffer)) {
+        cout << "Trace written to " << buffer << endl;
+        setLogMessage("Trace saved");
+    }
+}
+
+static void onTraceSignal(int) {
+    traceRequested = 1;
+}
+
+void installTraceSignal() {
+    struct sigaction action = {};
+    action.sa_handler = onTraceSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+bool consumeTraceRequest() {
+    if (!traceRequested) {
+        return false;
+    }
+    traceRequested = 0;
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+
+// Event recorder for chrome://tracing / Perfetto. Each thread writes into its
+// own ring buffer, so recording an event takes no lock; while tracing is off
+// the only cost is one relaxed load and a branch.
+extern atomic<bool> traceEnabled;
+
+// Name shown for the calling thread in the trace
+void setTraceThreadName(const char* name);
+
+// Record a complete event; name must be a string literal (it is stored as a pointer)
+void traceEvent(const char* name, steady_clock::time_point start, steady_clock::time_point end);
+
+void startTracing();
+void stopTracing();
+
+// Write the buffered events as Chrome trace JSON, returns false on failure
+bool writeTrace(const string& path);
+
+// Write to ./trace_<date>_<time>.json and report it in the log line
+void saveTrace();
+
+// SIGUSR1 asks the main loop to save the trace
+void installTraceSignal();
+bool consumeTraceRequest();
+
+// Records the enclosing scope as one event
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name), active(traceEnabled.load(memory_order_relaxed)) {
+        if (active) {
+            start = steady_clock::now();
+        }
+    }
+    ~TraceScope() {
+        if (active) {
+            traceEvent(name, start, steady_clock::now());
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+private:
+    const char* name;
+    bool active;
+    steady_clock::time_point start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
@@ -1,6 +1,11 @@
 #include "ui.h"
 #include "serial.h"
 #include "recording.h"
+#include "digital_zoom.h"
+#include "input_events.h"
+#include "export_job.h"
+#include "clock_service.h"
+#include "frame_pipeline.h"
 #include <filesystem>
 #include <vector>
 #include <dirent.h>
@@ -74,7 +79,11 @@ void initializeUI(int windowWidth, int windowHeight) {
 }
 
 void mouseCallback(int event, int x, int y, int flags, void* userdata) {
-    appConfig.loadConfig();
+    // Only record the event here, the main loop applies it between frames
+    pushInputEvent(InputEvent{event, x, y, flags});
+}
+
+void handleMouseEvent(int event, int x, int y, int flags) {
     if (event == EVENT_LBUTTONDOWN) {
         if (toggleNavButtonRect.contains(Point(x, y))) {
             showNavBar = !showNavBar;
@@ -133,23 +142,19 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
             // If not in a dialog and clicked in video area - activate background subtraction
             bgSubtractionActive = true;
             
-            // Create a 100x100 box centered at click position
+            // Create a 100x100 box (camera pixels) centered at the clicked frame position
             int boxSize = 100;
-            y = y * 720/800;
-            bgSubtractionRect = Rect(x - boxSize/2, y - boxSize/2, boxSize, boxSize);
+            Point framePoint = displayToFrame(Point(x, y), Size(DISPLAY_WIDTH, DISPLAY_HEIGHT));
+            bgSubtractionRect = Rect(framePoint.x - boxSize/2, framePoint.y - boxSize/2, boxSize, boxSize);
             
             // Reset background subtractor
             backgroundSubtractor = createBackgroundSubtractorMOG2(300, 16, true);
             
             // Reset variables
-            frameNumber = 0;
-            objectOccurrences.clear();
-            detectionPoints.clear();
-            detectionCounts.clear();
-            isTimedOut = false;
+            resetDetectionState();
             
             // Start the timer
-            bgSubStartTime = std::chrono::system_clock::now();
+            bgSubStartTime = frameCaptureTime;
             
             setLogMessage("BG active for 10 seconds");
             return;
@@ -250,18 +255,16 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
 
             if (isRecording) {
                 // Start recording code
-                time_t now = time(0);
-                char buffer[80];
-                strftime(buffer, 80, "%Y%m%d_%H%M%S", localtime(&now));
-                tempFilename = "/tmp/" + string(buffer) + "_temp.avi";
+                tempFilename = "/tmp/" + formatWallClock("%Y%m%d_%H%M%S") + "_temp.avi";
 
-                recordingStartTime = system_clock::now();
+                recordingStartTime = frameCaptureTime;
+                recordingDetectionEvents = 0;
                 setLogMessage("Rec started...");
                 progressValue = 0;
             } else {
                 // Stop recording code
                 if (videoWriter.isOpened()) {
-                    recordingDurationSeconds = duration<double>(system_clock::now() - recordingStartTime).count();
+                    recordingDurationSeconds = getRecordedSeconds();
                     videoWriter.release();
                     setLogMessage("Rec stopped");
 
@@ -276,12 +279,15 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
                     if (processingThread.joinable()) {
                         processingThread.join();
                     }
-                    processingThread = thread(postProcessVideo, tempFilename, recordingDurationSeconds);
+                    processingThread = thread(postProcessVideo, tempFilename, recordingDurationSeconds,
+                                              recordingDetectionEvents);
                 }
             }
         } else if (exportButtonRect.contains(Point(x, y))) {
             // Export button clicked - show export dialog
-            if (!isRecording) {
+            if (isExportRunning()) {
+                setLogMessage("Export in progress...");
+            } else if (!isRecording) {
                 showExportDialog = true;
                 createExportDialog(DISPLAY_WIDTH, DISPLAY_HEIGHT);
                 scanRecordingDirectory();
@@ -292,19 +298,41 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
         } else if (zoomInButtonRect.contains(Point(x, y))) {
             // Zoom in button pressed down
             isZoomInHeld = true;
-            lastZoomTime = system_clock::now();
-            // Perform initial zoom immediately
-            zoomIn();
+            lastZoomTime = frameCaptureTime;
+            if (continuousZoom) {
+                startContinuousZoom(true);
+            } else {
+                // Perform initial zoom immediately
+                zoomIn();
+            }
         } else if (zoomOutButtonRect.contains(Point(x, y))) {
             // Zoom out button pressed down
             isZoomOutHeld = true;
-            lastZoomTime = system_clock::now();
-            // Perform initial zoom immediately
-            zoomOut();
+            lastZoomTime = frameCaptureTime;
+            if (continuousZoom) {
+                startContinuousZoom(false);
+            } else {
+                // Perform initial zoom immediately
+                zoomOut();
+            }
+        } else if (panUpButtonRect.contains(Point(x, y))) {
+            panView(0, -1);
+        } else if (panDownButtonRect.contains(Point(x, y))) {
+            panView(0, 1);
+        }
+    }
+    else if (event == EVENT_MOUSEWHEEL) {
+        // Digital zoom on the preview, anchored at the cursor
+        if (videoRect.contains(Point(x, y)) && !showExportDialog) {
+            double factor = getMouseWheelDelta(flags) > 0 ? 1.25 : 1.0 / 1.25;
+            digitalZoomAt(factor, Point(x, y), Size(DISPLAY_WIDTH, DISPLAY_HEIGHT));
         }
     }
     else if (event == EVENT_LBUTTONUP) {
         // Handle button releases
+        if (continuousZoom && (isZoomInHeld || isZoomOutHeld)) {
+            stopContinuousZoom();
+        }
         isZoomInHeld = false;
         isZoomOutHeld = false;
         isDraggingMinHandle = false;
@@ -346,10 +374,12 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
         }
         
         // If mouse moved outside the button area while button is held, stop zooming
-        if (isZoomInHeld && !zoomInButtonRect.contains(Point(x, y))) {
+        if ((isZoomInHeld && !zoomInButtonRect.contains(Point(x, y))) ||
+            (isZoomOutHeld && !zoomOutButtonRect.contains(Point(x, y)))) {
+            if (continuousZoom) {
+                stopContinuousZoom();
+            }
             isZoomInHeld = false;
-        }
-        if (isZoomOutHeld && !zoomOutButtonRect.contains(Point(x, y))) {
             isZoomOutHeld = false;
         }
     }
@@ -379,12 +409,16 @@ void drawIR(Mat& frame, bool bgActive) {
     }
     
     // Don't redraw the background or toggle button - already done in drawBgSubControls
+
+    // Labels built once, drawn every frame
+    static const string ICR_LABELS[2] = {"ICR Mode: OFF", "ICR Mode: ON"};
+    static const string IR_CORRECTION_LABELS[2] = {"IR Correction: OFF", "IR Correction: ON"};
     
     // Draw ICR Mode button
     Scalar icrButtonColor = icrModeEnabled ? BUTTON_COLOR : Scalar(100, 100, 100);
     rectangle(frame, icrButtonRect, icrButtonColor, -1);
     rectangle(frame, icrButtonRect, HIGHLIGHT_COLOR, 1);
-    putText(frame, "ICR Mode: " + string(icrModeEnabled ? "ON" : "OFF"), 
+    putText(frame, ICR_LABELS[icrModeEnabled], 
             Point(icrButtonRect.x + 10, icrButtonRect.y + 20),
             FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
     
@@ -392,7 +426,7 @@ void drawIR(Mat& frame, bool bgActive) {
     Scalar irCorrectionColor = irCorrectionEnabled ? BUTTON_COLOR : Scalar(100, 100, 100);
     rectangle(frame, irCorrectionButtonRect, irCorrectionColor, -1);
     rectangle(frame, irCorrectionButtonRect, HIGHLIGHT_COLOR, 1);
-    putText(frame, "IR Correction: " + string(irCorrectionEnabled ? "ON" : "OFF"), 
+    putText(frame, IR_CORRECTION_LABELS[irCorrectionEnabled], 
             Point(irCorrectionButtonRect.x + 10, irCorrectionButtonRect.y + 20),
             FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
 }
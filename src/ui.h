@@ -10,9 +10,12 @@
 // Initialize UI components
 void initializeUI(int windowWidth, int windowHeight);
 
-// Mouse callback function 
+// Mouse callback function (only queues the event)
 void mouseCallback(int event, int x, int y, int flags, void* userdata);
 
+// Apply a queued mouse event to the UI state (main loop only)
+void handleMouseEvent(int event, int x, int y, int flags);
+
 void initIR(int x, int y, int width, int height);
 
 void drawIR(Mat& frame, bool bgActive);
@@ -0,0 +1,124 @@
+#ifndef VISCA_COMMANDS_H
+#define VISCA_COMMANDS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// VISCA packets built at compile time: 8x header, body, FF terminator.
+// Fixed commands are constants, parameterized ones are packed into
+// 0p 0q 0r 0s nibbles by constexpr encoders, so nothing is formatted
+// or parsed at run time and every packet has the right length.
+
+template<size_t N>
+using ViscaPacket = array<uint8_t, N>;
+
+// Camera 1; broadcast/other addresses are not used by this application
+static constexpr uint8_t VISCA_HEADER = 0x81;
+static constexpr uint8_t VISCA_TERMINATOR = 0xFF;
+
+// Highest zoom position accepted by zoom direct (optical + digital)
+static constexpr int VISCA_ZOOM_MAX = 0x4000;
+
+// Fixed command from its body bytes
+template<uint8_t... Body>
+constexpr ViscaPacket<sizeof...(Body) + 2> viscaCommand() {
+    return ViscaPacket<sizeof...(Body) + 2>{{VISCA_HEADER, Body..., VISCA_TERMINATOR}};
+}
+
+// Command with a value packed into Nibbles bytes (most significant first)
+template<size_t Nibbles, uint8_t... Body>
+constexpr ViscaPacket<sizeof...(Body) + Nibbles + 2> viscaNibbleCommand(unsigned value) {
+    ViscaPacket<sizeof...(Body) + Nibbles + 2> packet{{VISCA_HEADER, Body...}};
+    for (size_t i = 0; i < Nibbles; i++) {
+        packet[1 + sizeof...(Body) + i] = (value >> (4 * (Nibbles - 1 - i))) & 0x0F;
+    }
+    packet[packet.size() - 1] = VISCA_TERMINATOR;
+    return packet;
+}
+
+// Inverse of the nibble packing, for inquiry replies (0p 0q 0r 0s)
+constexpr unsigned viscaDecodeNibbles(const uint8_t* data, size_t count) {
+    unsigned value = 0;
+    for (size_t i = 0; i < count; i++) {
+        value = (value << 4) | (data[i] & 0x0F);
+    }
+    return value;
+}
+
+constexpr int viscaClamp(int value, int low, int high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+// CAM_Zoom Direct: 81 01 04 47 0p 0q 0r 0s FF
+constexpr ViscaPacket<9> viscaZoomDirect(int position) {
+    return viscaNibbleCommand<4, 0x01, 0x04, 0x47>(viscaClamp(position, 0, VISCA_ZOOM_MAX));
+}
+
+// CAM_Focus Direct: 81 01 04 48 0p 0q 0r 0s FF
+constexpr ViscaPacket<9> viscaFocusDirect(int position) {
+    return viscaNibbleCommand<4, 0x01, 0x04, 0x48>(viscaClamp(position, 0, 0xFFFF));
+}
+
+// CAM_Zoom Tele/Wide (variable): 81 01 04 07 2p/3p FF, speed p from 0 (low) to 7 (high)
+constexpr ViscaPacket<6> viscaZoomVariable(bool tele, int speed) {
+    ViscaPacket<6> packet = viscaCommand<0x01, 0x04, 0x07, 0x00>();
+    packet[4] = (tele ? 0x20 : 0x30) | viscaClamp(speed, 0, 7);
+    return packet;
+}
+
+static constexpr ViscaPacket<6> VISCA_ZOOM_STOP = viscaCommand<0x01, 0x04, 0x07, 0x00>();
+
+// CAM_ICR On/Off, CAM_IR_Correction IR light/standard
+static constexpr ViscaPacket<6> VISCA_ICR_ON = viscaCommand<0x01, 0x04, 0x01, 0x02>();
+static constexpr ViscaPacket<6> VISCA_ICR_OFF = viscaCommand<0x01, 0x04, 0x01, 0x03>();
+static constexpr ViscaPacket<6> VISCA_IR_CORRECTION_ON = viscaCommand<0x01, 0x04, 0x11, 0x01>();
+static constexpr ViscaPacket<6> VISCA_IR_CORRECTION_OFF = viscaCommand<0x01, 0x04, 0x11, 0x00>();
+
+// Inquiries: 81 09 ... FF, answered by 90 50 ... FF
+static constexpr ViscaPacket<5> VISCA_ZOOM_POSITION_INQUIRY = viscaCommand<0x09, 0x04, 0x47>();
+static constexpr ViscaPacket<5> VISCA_ICR_MODE_INQUIRY = viscaCommand<0x09, 0x04, 0x01>();
+static constexpr ViscaPacket<5> VISCA_IR_CORRECTION_INQUIRY = viscaCommand<0x09, 0x04, 0x11>();
+
+// Compare a packet with its hex notation ("8101040102FF"), for the checks below
+constexpr int viscaHexDigit(char c) {
+    return c >= '0' && c <= '9' ? c - '0' :
+           c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+           c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+template<size_t N>
+constexpr bool viscaMatchesHex(const ViscaPacket<N>& packet, const char* hex) {
+    for (size_t i = 0; i < N; i++) {
+        if (hex[2 * i] == '\0' || hex[2 * i + 1] == '\0' ||
+            viscaHexDigit(hex[2 * i]) * 16 + viscaHexDigit(hex[2 * i + 1]) != packet[i]) {
+            return false;
+        }
+    }
+    return hex[2 * N] == '\0';
+}
+
+// Presets of camera_interactive.py, verified when this header is compiled
+static_assert(viscaMatchesHex(viscaZoomDirect(0), "8101044700000000FF"), "zoom0");
+static_assert(viscaMatchesHex(viscaZoomDirect(0x10), "8101044700000100FF"), "zoom1");
+static_assert(viscaMatchesHex(viscaZoomDirect(0x1000), "8101044701000000FF"), "zoom_max");
+static_assert(viscaMatchesHex(VISCA_ICR_ON, "8101040102FF"), "icr_on");
+static_assert(viscaMatchesHex(VISCA_ICR_OFF, "8101040103FF"), "icr_off");
+static_assert(viscaMatchesHex(VISCA_IR_CORRECTION_ON, "8101041101FF"), "ir_on");
+static_assert(viscaMatchesHex(VISCA_IR_CORRECTION_OFF, "8101041100FF"), "ir_off");
+
+// Encoder edge cases
+static_assert(viscaMatchesHex(viscaZoomDirect(16384), "8101044704000000FF"), "zoom direct upper limit");
+static_assert(viscaMatchesHex(viscaZoomDirect(20000), "8101044704000000FF"), "zoom direct clamps high");
+static_assert(viscaMatchesHex(viscaZoomDirect(-5), "8101044700000000FF"), "zoom direct clamps low");
+static_assert(viscaMatchesHex(viscaZoomDirect(512), "8101044700020000FF"), "zoom direct nibbles");
+static_assert(viscaMatchesHex(viscaFocusDirect(0xABCD), "810104480A0B0C0DFF"), "focus direct nibbles");
+static_assert(viscaMatchesHex(viscaZoomVariable(true, 4), "8101040724FF"), "zoom tele variable");
+static_assert(viscaMatchesHex(viscaZoomVariable(false, 9), "8101040737FF"), "zoom wide clamps speed");
+static_assert(viscaMatchesHex(VISCA_ZOOM_STOP, "8101040700FF"), "zoom stop");
+static_assert(viscaMatchesHex(VISCA_ZOOM_POSITION_INQUIRY, "81090447FF"), "zoom inquiry");
+static_assert(!viscaMatchesHex(VISCA_ICR_ON, "8101040102"), "missing terminator");
+
+#endif // VISCA_COMMANDS_H
@@ -0,0 +1,116 @@
+#ifndef VISCA_REPLY_H
+#define VISCA_REPLY_H
+
+#include <cstddef>
+#include <cstring>
+
+// Longest VISCA packet, including header and terminator
+static const size_t VISCA_MAX_PACKET = 16;
+
+// One reply packet from the camera (z0 ... FF)
+struct ViscaReply {
+    enum Type {
+        ACK,            // z0 4y FF
+        COMPLETION,     // z0 5y [payload] FF, socket 0 for inquiry answers
+        ERROR,          // z0 6y ee FF
+        OTHER           // network change, address set, ...
+    };
+
+    Type type;
+    int address;        // camera address (1-7)
+    int socket;         // command socket (1-2), 0 for inquiries
+    int errorCode;      // error replies only
+    unsigned char payload[VISCA_MAX_PACKET];
+    size_t payloadSize;
+};
+
+// VISCA error codes
+static const int VISCA_ERROR_SYNTAX = 0x02;
+static const int VISCA_ERROR_BUFFER_FULL = 0x03;
+static const int VISCA_ERROR_CANCELED = 0x04;
+static const int VISCA_ERROR_NO_SOCKET = 0x05;
+static const int VISCA_ERROR_NOT_EXECUTABLE = 0x41;
+
+// Streaming parser: bytes can arrive split or merged in any way,
+// each complete packet is handed to the callback as soon as its FF arrives
+class ViscaReplyParser {
+public:
+    template<typename Callback>
+    void feed(const unsigned char* data, size_t length, Callback onReply) {
+        for (size_t i = 0; i < length; i++) {
+            unsigned char byte = data[i];
+
+            // A reply starts with z0 (z = camera address + 8); skip noise until one does
+            if (bufferLength == 0 && !isReplyHeader(byte)) {
+                droppedBytes++;
+                continue;
+            }
+
+            buffer[bufferLength++] = byte;
+            if (byte == 0xFF) {
+                ViscaReply reply;
+                if (decode(reply)) {
+                    onReply(reply);
+                } else {
+                    droppedBytes += bufferLength;
+                }
+                bufferLength = 0;
+            } else if (bufferLength == VISCA_MAX_PACKET) {
+                // No terminator where one must be: resynchronize
+                droppedBytes += bufferLength;
+                bufferLength = 0;
+            }
+        }
+    }
+
+    void reset() {
+        bufferLength = 0;
+    }
+
+    // Bytes discarded because they were not part of a valid packet
+    size_t getDroppedBytes() const {
+        return droppedBytes;
+    }
+
+private:
+    unsigned char buffer[VISCA_MAX_PACKET];
+    size_t bufferLength = 0;
+    size_t droppedBytes = 0;
+
+    static bool isReplyHeader(unsigned char byte) {
+        return byte >= 0x90 && byte <= 0xF0 && (byte & 0x0F) == 0;
+    }
+
+    bool decode(ViscaReply& reply) const {
+        if (bufferLength < 3) {
+            return false;
+        }
+        reply.address = (buffer[0] >> 4) - 8;
+        reply.socket = buffer[1] & 0x0F;
+        reply.errorCode = 0;
+        reply.payloadSize = bufferLength - 3;
+        memcpy(reply.payload, buffer + 2, reply.payloadSize);
+
+        switch (buffer[1] & 0xF0) {
+            case 0x40:
+                reply.type = ViscaReply::ACK;
+                break;
+            case 0x50:
+                reply.type = ViscaReply::COMPLETION;
+                break;
+            case 0x60:
+                if (bufferLength != 4) {
+                    return false;
+                }
+                reply.type = ViscaReply::ERROR;
+                reply.errorCode = buffer[2];
+                break;
+            default:
+                reply.type = ViscaReply::OTHER;
+                break;
+        }
+        return true;
+    }
+};
+
+#endif // VISCA_REPLY_H
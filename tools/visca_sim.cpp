@@ -0,0 +1,331 @@
+#include "visca_sim.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <pty.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace std::chrono;
+
+static const int ZOOM_MAX = 0x4000;
+static const size_t MAX_PACKET = 16;
+
+// A reply waiting for its time to be written
+struct ScheduledReply {
+    steady_clock::time_point dueAt;
+    vector<unsigned char> bytes;
+    int releaseSocket;      // socket freed when this reply goes out, 0 if none
+};
+
+static ViscaSimOptions simOptions;
+static thread simThread;
+static atomic<bool> simRunning(false);
+static int masterFd = -1;
+static int slaveFd = -1;
+
+static mutex simStateMutex;
+static ViscaSimStats simStats;
+
+// Camera state, only touched by the simulator thread (stats copy under simStateMutex)
+static bool socketBusy[3] = {false, false, false};
+static int zoomFrom = 0;
+static int zoomTo = 0;
+static steady_clock::time_point zoomStart;
+static steady_clock::time_point zoomEnd;
+static int zoomVariableDirection = 0;   // +1 tele, -1 wide, 0 stopped
+static int zoomVariableSpeed = 0;
+static int zoomSocket = 0;              // socket of a zoom direct still moving
+static bool icrMode = false;
+static bool irCorrection = false;
+static vector<ScheduledReply> scheduledReplies;
+static steady_clock::time_point lineFreeAt;
+static mt19937 errorRandom(12345);
+
+static int zoomPositionAt(steady_clock::time_point now) {
+    if (zoomVariableDirection != 0) {
+        // Speed 0-7 maps to 1/8 - 8/8 of the zoom direct rate
+        double perMs = double(ZOOM_MAX) / simOptions.zoomFullRangeMs * (zoomVariableSpeed + 1) / 8.0;
+        double elapsedMs = duration<double, milli>(now - zoomStart).count();
+        int position = zoomFrom + int(zoomVariableDirection * perMs * elapsedMs);
+        return max(0, min(ZOOM_MAX, position));
+    }
+    if (now >= zoomEnd) {
+        return zoomTo;
+    }
+    double progress = duration<double>(now - zoomStart).count() / duration<double>(zoomEnd - zoomStart).count();
+    return zoomFrom + int((zoomTo - zoomFrom) * progress);
+}
+
+static void updateStats(steady_clock::time_point now) {
+    lock_guard<mutex> lock(simStateMutex);
+    simStats.zoomPosition = zoomPositionAt(now);
+    simStats.icrMode = icrMode;
+    simStats.irCorrection = irCorrection;
+}
+
+// Queue a reply to be sent once it is due and the line is free
+static void scheduleReply(steady_clock::time_point dueAt, vector<unsigned char> bytes, int releaseSocket = 0) {
+    if (simOptions.silent) {
+        if (releaseSocket > 0) {
+            socketBusy[releaseSocket] = false;
+        }
+        return;
+    }
+    scheduledReplies.push_back(ScheduledReply{dueAt, std::move(bytes), releaseSocket});
+}
+
+static int allocateSocket() {
+    for (int socket = 1; socket <= 2; socket++) {
+        if (!socketBusy[socket]) {
+            socketBusy[socket] = true;
+            return socket;
+        }
+    }
+    return 0;
+}
+
+static void replyError(steady_clock::time_point now, int socket, int errorCode) {
+    {
+        lock_guard<mutex> lock(simStateMutex);
+        simStats.errors++;
+    }
+    scheduleReply(now + milliseconds(simOptions.ackDelayMs),
+                  {0x90, (unsigned char)(0x60 | socket), (unsigned char)errorCode, 0xFF});
+}
+
+static void handleInquiry(const vector<unsigned char>& packet, steady_clock::time_point now) {
+    vector<unsigned char> reply;
+    if (packet.size() == 5 && packet[2] == 0x04 && packet[3] == 0x47) {
+        int position = zoomPositionAt(now);
+        reply = {0x90, 0x50, (unsigned char)((position >> 12) & 0x0F), (unsigned char)((position >> 8) & 0x0F),
+                 (unsigned char)((position >> 4) & 0x0F), (unsigned char)(position & 0x0F), 0xFF};
+    } else if (packet.size() == 5 && packet[2] == 0x04 && packet[3] == 0x01) {
+        reply = {0x90, 0x50, (unsigned char)(icrMode ? 0x02 : 0x03), 0xFF};
+    } else if (packet.size() == 5 && packet[2] == 0x04 && packet[3] == 0x11) {
+        reply = {0x90, 0x50, (unsigned char)(irCorrection ? 0x01 : 0x00), 0xFF};
+    } else {
+        replyError(now, 0, 0x02);
+        return;
+    }
+    {
+        lock_guard<mutex> lock(simStateMutex);
+        simStats.inquiries++;
+    }
+    scheduleReply(now + milliseconds(simOptions.ackDelayMs), reply);
+}
+
+static void handleCommand(const vector<unsigned char>& packet, steady_clock::time_point now) {
+    // Recognize the command before taking a socket
+    bool zoomDirect = packet.size() == 9 && packet[2] == 0x04 && packet[3] == 0x47;
+    bool zoomVariable = packet.size() == 6 && packet[2] == 0x04 && packet[3] == 0x07 &&
+                        (packet[4] == 0x00 || (packet[4] & 0xF0) == 0x20 || (packet[4] & 0xF0) == 0x30);
+    bool icr = packet.size() == 6 && packet[2] == 0x04 && packet[3] == 0x01 &&
+               (packet[4] == 0x02 || packet[4] == 0x03);
+    bool ir = packet.size() == 6 && packet[2] == 0x04 && packet[3] == 0x11 && packet[4] <= 0x01;
+    if (!zoomDirect && !zoomVariable && !icr && !ir) {
+        replyError(now, 0, 0x02);
+        return;
+    }
+
+    int socket = allocateSocket();
+    if (socket == 0) {
+        lock_guard<mutex> lock(simStateMutex);
+        simStats.bufferFull++;
+        scheduleReply(now + milliseconds(simOptions.ackDelayMs), {0x90, 0x60, 0x03, 0xFF});
+        return;
+    }
+
+    steady_clock::time_point ackAt = now + milliseconds(simOptions.ackDelayMs);
+    scheduleReply(ackAt, {0x90, (unsigned char)(0x40 | socket), 0xFF});
+    {
+        lock_guard<mutex> lock(simStateMutex);
+        simStats.commands++;
+    }
+
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    if (simOptions.errorRate > 0 && chance(errorRandom) < simOptions.errorRate) {
+        socketBusy[socket] = false;
+        replyError(ackAt, socket, 0x41);
+        return;
+    }
+
+    // A new zoom command takes over the lens; the one it interrupts completes now
+    if ((zoomDirect || zoomVariable) && zoomSocket != 0) {
+        for (ScheduledReply& reply : scheduledReplies) {
+            if (reply.releaseSocket == zoomSocket) {
+                reply.dueAt = min(reply.dueAt, ackAt);
+            }
+        }
+        zoomSocket = 0;
+    }
+
+    steady_clock::time_point doneAt = ackAt + milliseconds(simOptions.completionDelayMs);
+    if (zoomDirect) {
+        int target = (packet[4] & 0x0F) << 12 | (packet[5] & 0x0F) << 8 | (packet[6] & 0x0F) << 4 | (packet[7] & 0x0F);
+        if (target > ZOOM_MAX) {
+            socketBusy[socket] = false;
+            replyError(ackAt, socket, 0x41);
+            return;
+        }
+        zoomFrom = zoomPositionAt(now);
+        zoomTo = target;
+        zoomVariableDirection = 0;
+        zoomStart = now;
+        zoomEnd = now + milliseconds(abs(zoomTo - zoomFrom) * simOptions.zoomFullRangeMs / ZOOM_MAX);
+        doneAt = max(ackAt, zoomEnd);
+        zoomSocket = socket;
+    } else if (zoomVariable) {
+        // Variable zoom completes at once, the lens keeps moving until stopped
+        zoomFrom = zoomPositionAt(now);
+        zoomStart = now;
+        zoomEnd = now;
+        zoomTo = zoomFrom;
+        zoomVariableDirection = packet[4] == 0x00 ? 0 : ((packet[4] & 0xF0) == 0x20 ? 1 : -1);
+        zoomVariableSpeed = packet[4] & 0x07;
+        doneAt = ackAt;
+    } else if (icr) {
+        icrMode = packet[4] == 0x02;
+    } else {
+        irCorrection = packet[4] == 0x01;
+    }
+    scheduleReply(doneAt, {0x90, (unsigned char)(0x50 | socket), 0xFF}, socket);
+}
+
+static void handlePacket(const vector<unsigned char>& packet) {
+    steady_clock::time_point now = steady_clock::now();
+    if (packet.size() < 4 || packet[0] != 0x81) {
+        replyError(now, 0, 0x02);
+        return;
+    }
+    if (packet[1] == 0x09) {
+        handleInquiry(packet, now);
+    } else if (packet[1] == 0x01) {
+        handleCommand(packet, now);
+    } else {
+        replyError(now, 0, 0x02);
+    }
+}
+
+static void flushDueReplies(steady_clock::time_point now) {
+    sort(scheduledReplies.begin(), scheduledReplies.end(),
+         [](const ScheduledReply& a, const ScheduledReply& b) { return a.dueAt < b.dueAt; });
+    size_t sent = 0;
+    for (; sent < scheduledReplies.size() && scheduledReplies[sent].dueAt <= now && lineFreeAt <= now; sent++) {
+        const ScheduledReply& reply = scheduledReplies[sent];
+        if (write(masterFd, reply.bytes.data(), reply.bytes.size()) < 0) {
+            cerr << "visca_sim: write failed: " << strerror(errno) << endl;
+        }
+        if (reply.releaseSocket > 0) {
+            socketBusy[reply.releaseSocket] = false;
+            if (reply.releaseSocket == zoomSocket) {
+                zoomSocket = 0;
+            }
+        }
+        if (simOptions.baudRate > 0) {
+            // One packet at a time on the wire, 10 bits per byte (start, 8 data, stop)
+            lineFreeAt = now + microseconds(reply.bytes.size() * 10 * 1000000LL / simOptions.baudRate);
+        }
+    }
+    scheduledReplies.erase(scheduledReplies.begin(), scheduledReplies.begin() + sent);
+}
+
+static void simulatorLoop() {
+    vector<unsigned char> packet;
+    unsigned char buffer[256];
+
+    while (simRunning) {
+        steady_clock::time_point now = steady_clock::now();
+        int timeout = 50;
+        for (const ScheduledReply& reply : scheduledReplies) {
+            long long untilDue = duration_cast<milliseconds>(max(reply.dueAt, lineFreeAt) - now).count();
+            timeout = min<long long>(timeout, max(0LL, untilDue));
+        }
+
+        struct pollfd pfd = {masterFd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t count = read(masterFd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < count; i++) {
+                // Resynchronize on the next header after garbage
+                if (packet.empty() && (buffer[i] & 0xF0) != 0x80) {
+                    continue;
+                }
+                packet.push_back(buffer[i]);
+                if (buffer[i] == 0xFF) {
+                    handlePacket(packet);
+                    packet.clear();
+                } else if (packet.size() >= MAX_PACKET) {
+                    packet.clear();
+                }
+            }
+        }
+
+        now = steady_clock::now();
+        flushDueReplies(now);
+        updateStats(now);
+    }
+}
+
+bool startViscaSimulator(const ViscaSimOptions& options, string& devicePath) {
+    if (simRunning) {
+        return false;
+    }
+
+    char name[256];
+    if (openpty(&masterFd, &slaveFd, name, nullptr, nullptr) < 0) {
+        cerr << "visca_sim: openpty failed: " << strerror(errno) << endl;
+        return false;
+    }
+
+    // Raw bytes in both directions; the slave stays open so the master never sees a hangup
+    struct termios raw;
+    tcgetattr(slaveFd, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slaveFd, TCSANOW, &raw);
+    fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+    simOptions = options;
+    simStats = ViscaSimStats();
+    for (bool& busy : socketBusy) {
+        busy = false;
+    }
+    zoomFrom = zoomTo = 0;
+    zoomStart = zoomEnd = lineFreeAt = steady_clock::now();
+    zoomVariableDirection = 0;
+    zoomSocket = 0;
+    icrMode = false;
+    irCorrection = false;
+    scheduledReplies.clear();
+
+    devicePath = name;
+    simRunning = true;
+    simThread = thread(simulatorLoop);
+    return true;
+}
+
+void stopViscaSimulator() {
+    if (!simRunning) {
+        return;
+    }
+    simRunning = false;
+    if (simThread.joinable()) {
+        simThread.join();
+    }
+    close(masterFd);
+    close(slaveFd);
+    masterFd = slaveFd = -1;
+}
+
+ViscaSimStats getViscaSimStats() {
+    lock_guard<mutex> lock(simStateMutex);
+    return simStats;
+}
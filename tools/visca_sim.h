@@ -0,0 +1,37 @@
+#ifndef VISCA_SIM_H
+#define VISCA_SIM_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Behaviour of the simulated camera
+struct ViscaSimOptions {
+    int ackDelayMs = 2;             // command received -> ACK
+    int completionDelayMs = 20;     // ACK -> Completion for settings (ICR, IR correction)
+    int zoomFullRangeMs = 3000;     // zoom direct from wide end to 0x4000
+    int baudRate = 9600;            // replies are delayed by their transmission time, 0 = instant
+    double errorRate = 0.0;         // share of commands answered with "not executable"
+    bool silent = false;            // never reply, like cameras without VISCA replies
+};
+
+// What the simulated camera has seen so far
+struct ViscaSimStats {
+    size_t commands;        // commands accepted (ACKed)
+    size_t inquiries;       // inquiries answered
+    size_t bufferFull;      // commands rejected because both sockets were busy
+    size_t errors;          // syntax / not executable replies
+    int zoomPosition;
+    bool icrMode;
+    bool irCorrection;
+};
+
+// Start the simulator on a new pseudo-terminal; devicePath receives the
+// slave side (e.g. /dev/pts/3) to open like a camera serial port
+bool startViscaSimulator(const ViscaSimOptions& options, string& devicePath);
+void stopViscaSimulator();
+
+ViscaSimStats getViscaSimStats();
+
+#endif // VISCA_SIM_H
@@ -0,0 +1,86 @@
+// Stand-alone VISCA camera simulator.
+// Prints the pseudo-terminal to use as the camera port, e.g.:
+//   ./visca_sim --link /tmp/ttyVISCA
+//   SERIAL_PORT = /tmp/ttyVISCA   (in config.ini)
+#include "visca_sim.h"
+#include <iostream>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+static void printUsage(const char* program) {
+    cout << "Usage: " << program << " [options]\n"
+         << "  --ack-ms N           delay before ACK (default 2)\n"
+         << "  --completion-ms N    ACK to Completion for settings (default 20)\n"
+         << "  --zoom-range-ms N    zoom time from wide end to 0x4000 (default 3000)\n"
+         << "  --baud N             emulate line speed, 0 = instant (default 9600)\n"
+         << "  --error-rate X       share of commands answered 'not executable' (default 0)\n"
+         << "  --silent             never reply\n"
+         << "  --link PATH          create a symlink to the pty at PATH\n";
+}
+
+int main(int argc, char** argv) {
+    ViscaSimOptions options;
+    string linkPath;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--ack-ms" && hasValue) {
+            options.ackDelayMs = atoi(argv[++i]);
+        } else if (arg == "--completion-ms" && hasValue) {
+            options.completionDelayMs = atoi(argv[++i]);
+        } else if (arg == "--zoom-range-ms" && hasValue) {
+            options.zoomFullRangeMs = max(1, atoi(argv[++i]));
+        } else if (arg == "--baud" && hasValue) {
+            options.baudRate = atoi(argv[++i]);
+        } else if (arg == "--error-rate" && hasValue) {
+            options.errorRate = atof(argv[++i]);
+        } else if (arg == "--silent") {
+            options.silent = true;
+        } else if (arg == "--link" && hasValue) {
+            linkPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    string devicePath;
+    if (!startViscaSimulator(options, devicePath)) {
+        return 1;
+    }
+    cout << "VISCA camera simulator on " << devicePath << endl;
+
+    if (!linkPath.empty()) {
+        unlink(linkPath.c_str());
+        if (symlink(devicePath.c_str(), linkPath.c_str()) < 0) {
+            cerr << "Could not create " << linkPath << ": " << strerror(errno) << endl;
+        } else {
+            cout << "Linked as " << linkPath << endl;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    while (!stopRequested) {
+        pause();
+    }
+
+    stopViscaSimulator();
+    if (!linkPath.empty()) {
+        unlink(linkPath.c_str());
+    }
+
+    ViscaSimStats stats = getViscaSimStats();
+    cout << "Commands: " << stats.commands << ", inquiries: " << stats.inquiries
+         << ", buffer full: " << stats.bufferFull << ", errors: " << stats.errors << endl;
+    return 0;
+}